@@ -0,0 +1,270 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	MathBenchmark.cpp
+// Purpose:	Microbenchmark (MathBenchmark.vcxproj) of the inline math of
+//			SimdMath.h against the same operations through aexmath.dll.
+//			Each test runs both versions on the same data, checks that they
+//			agree and writes the timings as JSON.
+//
+//	Usage:	MathBenchmark [-count N] [-repeat N] [-out file.json]
+// ----------------------------------------------------------------------------
+#include "src\Engine\Math\SimdMath.h"
+#include "src\Engine\Platform\AEXTime.h"
+#include "extern\Json\json.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+using namespace AEX;
+using json = nlohmann::json;
+
+namespace
+{
+	// same sequence on every run and platform (rand() isn't)
+	struct Random
+	{
+		u32 mState = 12345;
+		f32 operator()(f32 min, f32 max)
+		{
+			mState = mState * 1664525u + 1013904223u;
+			return min + (max - min) * ((mState >> 8) * (1.0f / 16777216.0f));
+		}
+	};
+
+	// keeps the results alive, so the optimizer can't drop the loops
+	volatile f32 gSink = 0.0f;
+
+	// ----------------------------------------------------------------------------
+	// \struct	BenchResult
+	struct BenchResult
+	{
+		const char *	mName;
+		f64				mDllTime;
+		f64				mSimdTime;
+		f64				mMaxError;	// between both versions
+	};
+
+	json ToJson(const BenchResult & r, u32 count, u32 repeat)
+	{
+		json j;
+		j["test"] = r.mName;
+		j["count"] = count;
+		j["repeat"] = repeat;
+		j["dll_ms"] = r.mDllTime * 1000.0;
+		j["simd_ms"] = r.mSimdTime * 1000.0;
+		j["speedup"] = r.mSimdTime > 0.0 ? r.mDllTime / r.mSimdTime : 0.0;
+		j["max_error"] = r.mMaxError;
+		return j;
+	}
+
+	// ----------------------------------------------------------------------------
+	// solver like: relative velocity along a normal, impulse applied to both
+	BenchResult BenchImpulses(u32 count, u32 repeat)
+	{
+		Random random;
+		std::vector<AEVec2> v1(count), v2(count), n(count);
+		for (u32 i = 0; i < count; ++i)
+		{
+			v1[i] = AEVec2(random(-10.0f, 10.0f), random(-10.0f, 10.0f));
+			v2[i] = AEVec2(random(-10.0f, 10.0f), random(-10.0f, 10.0f));
+			n[i].FromAngle(random(0.0f, TWO_PI));
+		}
+		std::vector<AEVec2> a1 = v1, a2 = v2, b1 = v1, b2 = v2;
+
+		BenchResult r = { "vec2_impulses", 0.0, 0.0, 0.0 };
+		f64 time = FRC::GetCPUTime();
+		for (u32 k = 0; k < repeat; ++k)
+		{
+			for (u32 i = 0; i < count; ++i)
+			{
+				f32 vn = (a2[i] - a1[i]) * n[i];
+				AEVec2 P = n[i] * (-0.5f * vn);
+				a1[i] -= P;
+				a2[i] += P;
+			}
+		}
+		r.mDllTime = FRC::GetCPUTime() - time;
+
+		time = FRC::GetCPUTime();
+		for (u32 k = 0; k < repeat; ++k)
+		{
+			for (u32 i = 0; i < count; ++i)
+			{
+				Simd::Vec2 & s1 = Simd::AsSimd(b1[i]);
+				Simd::Vec2 & s2 = Simd::AsSimd(b2[i]);
+				const Simd::Vec2 & sn = Simd::AsSimd(n[i]);
+				f32 vn = (s2 - s1) * sn;
+				Simd::Vec2 P = sn * (-0.5f * vn);
+				s1 -= P;
+				s2 += P;
+			}
+		}
+		r.mSimdTime = FRC::GetCPUTime() - time;
+
+		for (u32 i = 0; i < count; ++i)
+		{
+			r.mMaxError = (std::max)(r.mMaxError, static_cast<f64>(fabsf(a1[i].x - b1[i].x) + fabsf(a1[i].y - b1[i].y)));
+			r.mMaxError = (std::max)(r.mMaxError, static_cast<f64>(fabsf(a2[i].x - b2[i].x) + fabsf(a2[i].y - b2[i].y)));
+		}
+		gSink = a1[0].x + b1[0].x;
+		return r;
+	}
+
+	// ----------------------------------------------------------------------------
+	// polygon vertices to world space
+	BenchResult BenchTransformPoints(u32 count, u32 repeat)
+	{
+		Random random;
+		std::vector<AEVec2> points(count), a(count), b(count);
+		for (u32 i = 0; i < count; ++i)
+			points[i] = AEVec2(random(-1.0f, 1.0f), random(-1.0f, 1.0f));
+		Transform tr(AEVec2(3.0f, -2.0f), AEVec2(2.0f, 0.5f), 0.7f);
+		AEMtx33 mtx = tr.GetMatrix();
+
+		BenchResult r = { "mtx33_transform_points", 0.0, 0.0, 0.0 };
+		f64 time = FRC::GetCPUTime();
+		for (u32 k = 0; k < repeat; ++k)
+		{
+			for (u32 i = 0; i < count; ++i)
+				a[i] = mtx * points[i];
+		}
+		r.mDllTime = FRC::GetCPUTime() - time;
+
+		time = FRC::GetCPUTime();
+		for (u32 k = 0; k < repeat; ++k)
+			Simd::TransformPoints(mtx, &points[0], &b[0], count);
+		r.mSimdTime = FRC::GetCPUTime() - time;
+
+		for (u32 i = 0; i < count; ++i)
+			r.mMaxError = (std::max)(r.mMaxError, static_cast<f64>(fabsf(a[i].x - b[i].x) + fabsf(a[i].y - b[i].y)));
+		gSink = a[0].x + b[0].x;
+		return r;
+	}
+
+	// ----------------------------------------------------------------------------
+	// model to world 4x4 of the renderer: T * R * S
+	BenchResult BenchMtx44(u32 count, u32 repeat)
+	{
+		Random random;
+		std::vector<AEMtx44> t, s, a(count), b(count);
+		t.reserve(count);
+		s.reserve(count);
+		for (u32 i = 0; i < count; ++i)
+		{
+			t.push_back(AEMtx44::Translate(random(-100.0f, 100.0f), random(-100.0f, 100.0f), random(0.0f, 1.0f)));
+			s.push_back(AEMtx44::Scale(random(0.1f, 5.0f), random(0.1f, 5.0f), 1.0f));
+		}
+		AEMtx44 rot = AEMtx44::RotateXYZ(0.0f, 0.0f, 0.3f);
+
+		BenchResult r = { "mtx44_multiply", 0.0, 0.0, 0.0 };
+		f64 time = FRC::GetCPUTime();
+		for (u32 k = 0; k < repeat; ++k)
+		{
+			for (u32 i = 0; i < count; ++i)
+				a[i] = t[i] * rot * s[i];
+		}
+		r.mDllTime = FRC::GetCPUTime() - time;
+
+		time = FRC::GetCPUTime();
+		Simd::Mtx44 simdRot = Simd::Load(rot);
+		for (u32 k = 0; k < repeat; ++k)
+		{
+			for (u32 i = 0; i < count; ++i)
+				Simd::Store(Simd::Load(t[i]) * simdRot * Simd::Load(s[i]), b[i]);
+		}
+		r.mSimdTime = FRC::GetCPUTime() - time;
+
+		for (u32 i = 0; i < count; ++i)
+			for (u32 j = 0; j < 16; ++j)
+				r.mMaxError = (std::max)(r.mMaxError, static_cast<f64>(fabsf(a[i].v[j] - b[i].v[j])));
+		gSink = a[0].v[0] + b[0].v[0];
+		return r;
+	}
+
+	// ----------------------------------------------------------------------------
+	// sinf + cosf (CRT) against Simd::SinCos, angles in [-2PI, 2PI]
+	BenchResult BenchSinCos(u32 count, u32 repeat)
+	{
+		Random random;
+		std::vector<f32> angles(count), a(count * 2), b(count * 2);
+		for (u32 i = 0; i < count; ++i)
+			angles[i] = random(-TWO_PI, TWO_PI);
+
+		BenchResult r = { "sincos", 0.0, 0.0, 0.0 };
+		f64 time = FRC::GetCPUTime();
+		for (u32 k = 0; k < repeat; ++k)
+		{
+			for (u32 i = 0; i < count; ++i)
+			{
+				a[i * 2] = sinf(angles[i]);
+				a[i * 2 + 1] = cosf(angles[i]);
+			}
+		}
+		r.mDllTime = FRC::GetCPUTime() - time;
+
+		time = FRC::GetCPUTime();
+		for (u32 k = 0; k < repeat; ++k)
+		{
+			for (u32 i = 0; i < count; ++i)
+				Simd::SinCos(angles[i], &b[i * 2], &b[i * 2 + 1]);
+		}
+		r.mSimdTime = FRC::GetCPUTime() - time;
+
+		for (u32 i = 0; i < count * 2; ++i)
+			r.mMaxError = (std::max)(r.mMaxError, static_cast<f64>(fabsf(a[i] - b[i])));
+		gSink = a[0] + b[0];
+		return r;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	u32 count = 4096, repeat = 500;
+	const char * outPath = NULL;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (!strcmp(argv[i], "-count"))
+			count = static_cast<u32>(atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "-repeat"))
+			repeat = static_cast<u32>(atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "-out"))
+			outPath = argv[i + 1];
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (!count)
+		count = 1;
+	if (!repeat)
+		repeat = 1;
+
+	json results = json::array();
+	results.push_back(ToJson(BenchImpulses(count, repeat), count, repeat));
+	results.push_back(ToJson(BenchTransformPoints(count, repeat), count, repeat));
+	results.push_back(ToJson(BenchMtx44(count, repeat), count, repeat));
+	results.push_back(ToJson(BenchSinCos(count, repeat), count, repeat));
+
+	json report;
+	report["benchmark"] = "math";
+	report["results"] = results;
+
+	if (outPath)
+	{
+		std::ofstream file(outPath);
+		if (!file.is_open())
+		{
+			fprintf(stderr, "can't open %s\n", outPath);
+			return 1;
+		}
+		file << report.dump(2) << std::endl;
+	}
+	else
+		std::cout << report.dump(2) << std::endl;
+	return 0;
+}
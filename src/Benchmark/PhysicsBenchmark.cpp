@@ -0,0 +1,494 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	PhysicsBenchmark.cpp
+// Purpose:	Headless physics benchmark (PhysicsBenchmark.vcxproj). Builds the
+//			canonical scenes at several body counts, steps the PhysicsSystem
+//			for a fixed number of frames and writes the timings as JSON.
+//			The integration is also timed alone (scene "integrator"), to
+//			compare the bulk integrator with the alternatives.
+//			No window, no GLFW: the bodies are built without GameObject.
+//
+//	Usage:	PhysicsBenchmark [-frames N] [-threads N] [-scene name]
+//								 [-count N] [-out file.json]
+// ----------------------------------------------------------------------------
+#include "src\Engine\Physics\AEXPhysicsSystem.h"
+#include "src\Engine\Physics\AEXCollisionSystem.h"
+#include "src\Engine\Components\AEXComponents.h"
+#include "src\Engine\Platform\AEXTime.h"
+#include "src\Engine\Core\AEXJobSystem.h"
+#include "src\Engine\Math\Raycast.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <xmmintrin.h>	// SSE, the SoA kernel
+
+using namespace AEX;
+
+namespace AEX
+{
+	// AEXGameObject.cpp depends on the graphics. The benchmark bodies have no
+	// owner, so the components never get here.
+	IComp* GameObject::GetComp(const char *) const { return NULL; }
+}
+
+namespace
+{
+	// ----------------------------------------------------------------------------
+	// Body: the components a GameObject would own
+	struct BenchBody
+	{
+		TransformComp	mTransform;
+		RigidBody		mRigidBody;
+		Collider		mCollider;
+	};
+
+	// ----------------------------------------------------------------------------
+	// \struct	BenchScene
+	// \brief	Owns the bodies of a scene and registers them in the systems.
+	struct BenchScene
+	{
+		std::vector<BenchBody*> mBodies;
+		u32 mDynamicCount = 0;
+		u32 mStaticCount = 0;
+		u32 mRandom = 12345;
+
+		~BenchScene()
+		{
+			aexPhysics->ClearBodies();
+			CollisionSystem::Instance()->ClearBodies();
+			FOR_EACH(it, mBodies)
+				delete *it;
+		}
+
+		// same sequence on every run and platform (rand() isn't)
+		f32 Random(f32 min, f32 max)
+		{
+			mRandom = mRandom * 1664525u + 1013904223u;
+			return min + (max - min) * ((mRandom >> 8) / 16777216.0f);
+		}
+
+		BenchBody * Add(ECollisionShape shape, const AEVec2 & pos, const AEVec2 & scale, f32 angle, bool dynamic)
+		{
+			BenchBody * body = new BenchBody;
+			body->mTransform.mLocal = Transform(pos, scale, angle);
+
+			Collider & collider = body->mCollider;
+			collider.mCollisionShape = shape;
+			collider.DynamicState = dynamic ? Dynamic : Static;
+			collider.mTransform = &body->mTransform;
+
+			if (dynamic)
+			{
+				RigidBody & rb = body->mRigidBody;
+				rb.Gravity = AEVec2(0.0f, -10.0f);
+				rb.mTransform = &body->mTransform;
+				rb.mPrevious = body->mTransform.mLocal;
+				collider.mRigidBody = &rb;
+				aexPhysics->AddRigidBody(&rb);
+				mDynamicCount++;
+			}
+			else
+				mStaticCount++;
+
+			CollisionSystem::Instance()->AddRigidBody(&collider, dynamic);
+			mBodies.push_back(body);
+			return body;
+		}
+
+		// floor and two walls around [-halfWidth, halfWidth]
+		void AddContainer(f32 halfWidth, f32 height)
+		{
+			Add(CSHAPE_AABB, AEVec2(0.0f, -1.0f), AEVec2(halfWidth * 2.0f + 4.0f, 2.0f), 0.0f, false);
+			Add(CSHAPE_AABB, AEVec2(-halfWidth - 1.0f, height * 0.5f), AEVec2(2.0f, height), 0.0f, false);
+			Add(CSHAPE_AABB, AEVec2(halfWidth + 1.0f, height * 0.5f), AEVec2(2.0f, height), 0.0f, false);
+		}
+	};
+
+	// ----------------------------------------------------------------------------
+	// Canonical scenes. 'count' is the number of dynamic bodies.
+
+	// pyramids of unit boxes side by side on a floor (stacking, warm starting, sleeping)
+	void BuildPyramids(BenchScene & scene, u32 count)
+	{
+		const u32 base = 20;
+		const u32 perPyramid = base * (base + 1) / 2;
+		const u32 pyramids = (count + perPyramid - 1) / perPyramid;
+		const f32 pyramidWidth = base + 4.0f;
+
+		scene.Add(CSHAPE_AABB, AEVec2(0.0f, -1.0f), AEVec2(pyramids * pyramidWidth + 4.0f, 2.0f), 0.0f, false);
+
+		u32 added = 0;
+		for (u32 p = 0; p < pyramids; ++p)
+		{
+			f32 left = (p - pyramids * 0.5f) * pyramidWidth + 2.0f;
+			for (u32 row = 0; row < base && added < count; ++row)
+				for (u32 i = 0; i < base - row && added < count; ++i, ++added)
+				{
+					AEVec2 pos(left + row * 0.5f + i * 1.0f + 0.5f, row * 1.0f + 0.5f);
+					scene.Add(CSHAPE_AABB, pos, AEVec2(1.0f, 1.0f), 0.0f, true);
+				}
+		}
+	}
+
+	// circles falling in a container (many new contacts every frame)
+	void BuildRain(BenchScene & scene, u32 count)
+	{
+		const u32 columns = 64;
+		const f32 halfWidth = columns * 0.75f;
+		scene.AddContainer(halfWidth, count / columns * 1.5f + 20.0f);
+
+		for (u32 i = 0; i < count; ++i)
+		{
+			AEVec2 pos(-halfWidth + 0.75f + (i % columns) * 1.5f + scene.Random(-0.2f, 0.2f), 5.0f + (i / columns) * 1.5f);
+			BenchBody * body = scene.Add(CSHAPE_CIRCLE, pos, AEVec2(0.5f, 0.5f), 0.0f, true);
+			body->mRigidBody.Velocity = AEVec2(0.0f, scene.Random(-10.0f, 0.0f));
+		}
+	}
+
+	// rotated boxes (mostly), circles and polygons dropped in a container
+	void BuildObbPile(BenchScene & scene, u32 count)
+	{
+		const u32 columns = 32;
+		const f32 halfWidth = columns * 1.0f;
+		scene.AddContainer(halfWidth, count / columns * 2.0f + 20.0f);
+
+		const Polygon2D hexagon = Polygon2D::MakeHexagon();
+		for (u32 i = 0; i < count; ++i)
+		{
+			AEVec2 pos(-halfWidth + 1.0f + (i % columns) * 2.0f, 2.0f + (i / columns) * 2.0f);
+			f32 size = scene.Random(0.6f, 1.4f);
+			switch (i % 8)
+			{
+			case 0:
+				scene.Add(CSHAPE_CIRCLE, pos, AEVec2(size * 0.5f, size * 0.5f), 0.0f, true);
+				break;
+			case 1:
+				scene.Add(CSHAPE_POLYGON, pos, AEVec2(size, size), 0.0f, true)->mCollider.SetPolygon(hexagon);
+				break;
+			default:
+				scene.Add(CSHAPE_OBB, pos, AEVec2(size, scene.Random(0.6f, 1.4f)), scene.Random(0.0f, PI), true);
+				break;
+			}
+		}
+	}
+
+	// bodies drifting in a large world without gravity (broadphase, few contacts)
+	void BuildSparse(BenchScene & scene, u32 count)
+	{
+		const f32 halfSize = sqrtf(static_cast<f32>(count)) * 20.0f;
+		for (u32 i = 0; i < count / 16; ++i)
+		{
+			AEVec2 pos(scene.Random(-halfSize, halfSize), scene.Random(-halfSize, halfSize));
+			scene.Add(CSHAPE_AABB, pos, AEVec2(scene.Random(2.0f, 8.0f), scene.Random(2.0f, 8.0f)), 0.0f, false);
+		}
+		for (u32 i = 0; i < count; ++i)
+		{
+			AEVec2 pos(scene.Random(-halfSize, halfSize), scene.Random(-halfSize, halfSize));
+			BenchBody * body = scene.Add(i % 2 ? CSHAPE_CIRCLE : CSHAPE_AABB, pos, AEVec2(1.0f, 1.0f), 0.0f, true);
+			body->mRigidBody.Gravity = AEVec2(0.0f, 0.0f);
+			body->mRigidBody.LinearDrag = 1.0f;
+			body->mRigidBody.Velocity = AEVec2(scene.Random(-5.0f, 5.0f), scene.Random(-5.0f, 5.0f));
+		}
+	}
+
+	struct SceneDesc
+	{
+		const char * mName;
+		void(*mBuild)(BenchScene & scene, u32 count);
+	};
+	const SceneDesc gScenes[] =
+	{
+		{ "pyramid", BuildPyramids },
+		{ "rain", BuildRain },
+		{ "obb_pile", BuildObbPile },
+		{ "sparse", BuildSparse },
+	};
+	const u32 gCounts[] = { 256, 1024, 4096 };
+	const u32 gIntegratorCounts[] = { 1000, 10000, 100000 };
+
+	// ----------------------------------------------------------------------------
+	// \fn		RunScene
+	// \brief	Builds the scene, runs 'frames' fixed steps and returns the stats.
+	json RunScene(const SceneDesc & desc, u32 count, u32 frames, u32 threads)
+	{
+		PhysicsSystem * physics = aexPhysics;
+		CollisionSystem * collisions = CollisionSystem::Instance();
+		physics->Initialize();
+		collisions->SetThreadCount(threads);
+
+		BenchScene scene;
+		f64 time = FRC::GetCPUTime();
+		desc.mBuild(scene, count);
+		f64 buildTime = FRC::GetCPUTime() - time;
+
+		collisions->ResetPhaseTimes();
+		f64 totalTime = 0.0, maxStepTime = 0.0;
+		u64 pairs = 0, contacts = 0, subSteps = 0;
+		for (u32 i = 0; i < frames; ++i)
+		{
+			time = FRC::GetCPUTime();
+			physics->Step();
+			f64 stepTime = FRC::GetCPUTime() - time;
+
+			totalTime += stepTime;
+			if (stepTime > maxStepTime)
+				maxStepTime = stepTime;
+			pairs += collisions->mPairsThisFrame;
+			contacts += collisions->mCollisionsThisFrame;
+			subSteps += physics->GetSubStepsLastStep();
+		}
+
+		// everything that isn't the CollisionSystem is the integration
+		f64 collisionTime = 0.0;
+		json phases;
+		for (u32 i = 0; i < CPHASE_COUNT; ++i)
+		{
+			phases[GetCollisionPhaseName(i)] = collisions->mPhaseTimes[i] * 1000.0 / frames;
+			collisionTime += collisions->mPhaseTimes[i];
+		}
+		phases["integrate"] = (totalTime - collisionTime) * 1000.0 / frames;
+
+		json result;
+		result["scene"] = desc.mName;
+		result["bodies"] = scene.mDynamicCount;
+		result["static_bodies"] = scene.mStaticCount;
+		result["frames"] = frames;
+		result["threads"] = collisions->GetThreadCount();
+		result["build_ms"] = buildTime * 1000.0;
+		result["total_ms"] = totalTime * 1000.0;
+		result["avg_step_ms"] = totalTime * 1000.0 / frames;
+		result["max_step_ms"] = maxStepTime * 1000.0;
+		result["steps_per_sec"] = totalTime > 0.0 ? frames / totalTime : 0.0;
+		result["avg_substeps"] = static_cast<f64>(subSteps) / frames;
+		result["avg_pairs"] = static_cast<f64>(pairs) / frames;
+		result["avg_contacts"] = static_cast<f64>(contacts) / frames;
+		result["phases_ms"] = phases;
+		result["manifolds"] = collisions->GetManifoldCount();
+		result["awake_bodies"] = collisions->mActiveBodies;
+		result["sleeping_bodies"] = collisions->mSleepingBodies;
+		return result;
+	}
+
+	// ----------------------------------------------------------------------------
+	// \fn		RunIntegrator
+	// \brief	The integration alone (no colliders), average ms per step of:
+	//			- scalar: RigidBody::Step on every body
+	//			- bulk: PhysicsSystem::IntegrateBodies (gather from the
+	//			  components, SSE, scatter back), on 1 thread and on 'threads'
+	//			- soa_kernel: the same SSE loop on arrays that stay in SoA,
+	//			  the lower bound of a persistent SoA storage
+	//			- soa_writeback: the kernel plus the copy of the positions to
+	//			  the transforms, which the collisions and the rendering read
+	json RunIntegrator(u32 count, u32 frames, u32 threads)
+	{
+		PhysicsSystem * physics = aexPhysics;
+		CollisionSystem * collisions = CollisionSystem::Instance();
+		physics->Initialize();
+		const f32 dt = physics->mFixedTimeStep;
+
+		std::vector<BenchBody*> bodies(count);
+		for (u32 i = 0; i < count; ++i)
+		{
+			BenchBody * body = bodies[i] = new BenchBody;
+			body->mTransform.mLocal = Transform(AEVec2(static_cast<f32>(i % 1000), static_cast<f32>(i / 1000)), AEVec2(1.0f, 1.0f), 0.0f);
+			body->mRigidBody.Gravity = AEVec2(0.0f, -10.0f);
+			body->mRigidBody.mTransform = &body->mTransform;
+			physics->AddRigidBody(&body->mRigidBody);
+		}
+
+		f64 time = FRC::GetCPUTime();
+		for (u32 f = 0; f < frames; ++f)
+		{
+			FOR_EACH(it, bodies)
+				(*it)->mRigidBody.Step(dt);
+		}
+		const f64 scalarTime = FRC::GetCPUTime() - time;
+
+		collisions->SetThreadCount(1);
+		time = FRC::GetCPUTime();
+		for (u32 f = 0; f < frames; ++f)
+			physics->IntegrateBodies(dt);
+		const f64 bulkTime1 = FRC::GetCPUTime() - time;
+
+		collisions->SetThreadCount(threads);
+		time = FRC::GetCPUTime();
+		for (u32 f = 0; f < frames; ++f)
+			physics->IntegrateBodies(dt);
+		const f64 bulkTime = FRC::GetCPUTime() - time;
+
+		// persistent SoA: the arrays are the storage, nothing to gather
+		const u32 padded = (count + 3) & ~3u;
+		std::vector<f32> px(padded), py(padded), vx(padded), vy(padded), ax(padded), ay(padded), drag(padded, 1.0f);
+		for (u32 i = 0; i < count; ++i)
+		{
+			const RigidBody & rb = bodies[i]->mRigidBody;
+			px[i] = bodies[i]->mTransform.mLocal.mTranslation.x;
+			py[i] = bodies[i]->mTransform.mLocal.mTranslation.y;
+			vx[i] = rb.Velocity.x;
+			vy[i] = rb.Velocity.y;
+			ax[i] = rb.Gravity.x;
+			ay[i] = rb.Gravity.y;
+			drag[i] = rb.LinearDrag;
+		}
+		f64 kernelTime = 0.0, writebackTime = 0.0;
+		const __m128 step = _mm_set1_ps(dt);
+		for (u32 f = 0; f < frames; ++f)
+		{
+			time = FRC::GetCPUTime();
+			for (u32 i = 0; i < padded; i += 4)
+			{
+				__m128 d = _mm_loadu_ps(&drag[i]);
+				__m128 x = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&vx[i]), _mm_mul_ps(_mm_loadu_ps(&ax[i]), step)), d);
+				__m128 y = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&vy[i]), _mm_mul_ps(_mm_loadu_ps(&ay[i]), step)), d);
+				_mm_storeu_ps(&vx[i], x);
+				_mm_storeu_ps(&vy[i], y);
+				_mm_storeu_ps(&px[i], _mm_add_ps(_mm_loadu_ps(&px[i]), _mm_mul_ps(x, step)));
+				_mm_storeu_ps(&py[i], _mm_add_ps(_mm_loadu_ps(&py[i]), _mm_mul_ps(y, step)));
+			}
+			f64 kernelEnd = FRC::GetCPUTime();
+			kernelTime += kernelEnd - time;
+
+			for (u32 i = 0; i < count; ++i)
+				bodies[i]->mTransform.mLocal.mTranslation = AEVec2(px[i], py[i]);
+			writebackTime += FRC::GetCPUTime() - kernelEnd;
+		}
+
+		json result;
+		result["bodies"] = count;
+		result["frames"] = frames;
+		result["threads"] = collisions->GetThreadCount();
+		result["scalar_ms"] = scalarTime * 1000.0 / frames;
+		result["bulk_1_thread_ms"] = bulkTime1 * 1000.0 / frames;
+		result["bulk_ms"] = bulkTime * 1000.0 / frames;
+		result["soa_kernel_ms"] = kernelTime * 1000.0 / frames;
+		result["soa_writeback_ms"] = (kernelTime + writebackTime) * 1000.0 / frames;
+
+		physics->ClearBodies();
+		FOR_EACH(it, bodies)
+			delete *it;
+		return result;
+	}
+
+	// ----------------------------------------------------------------------------
+	// \fn		CheckQueries
+	// \brief	The scenes only step the physics, this checks that the ray
+	//			queries hit every shape. False (and why on stderr) if not.
+	bool CheckQueries()
+	{
+		aexPhysics->Initialize();
+		BenchScene scene;
+		scene.Add(CSHAPE_AABB, AEVec2(0.0f, 0.0f), AEVec2(2.0f, 2.0f), 0.0f, false);
+		scene.Add(CSHAPE_OBB, AEVec2(10.0f, 0.0f), AEVec2(2.0f, 2.0f), PI / 4.0f, false);
+		scene.Add(CSHAPE_CIRCLE, AEVec2(20.0f, 0.0f), AEVec2(1.0f, 1.0f), 0.0f, false);
+		scene.Add(CSHAPE_POLYGON, AEVec2(30.0f, 0.0f), AEVec2(2.0f, 2.0f), 0.0f, false)->mCollider.SetPolygon(Polygon2D::MakeHexagon());
+		aexPhysics->Step();	// the proxies
+
+		// from 5 units left of each body, to the right (off center, not
+		// through the corner of the rotated box)
+		CollisionSystem * collisions = CollisionSystem::Instance();
+		const f32 expected[] = { 4.0f, 5.0f - sqrtf(2.0f) + 0.25f, 5.0f - sqrtf(1.0f - 0.0625f) };
+		Ray rays[4];
+		for (u32 i = 0; i < 4; ++i)
+		{
+			rays[i].mOrigin = AEVec2(i * 10.0f - 5.0f, 0.25f);
+			rays[i].mDirection = AEVec2(1.0f, 0.0f);
+		}
+
+		RayCastHit hits[4];
+		bool ok = collisions->RayCast(rays, 4, 8.0f, 0xFFFFFFFF, hits) == 4;
+		for (u32 i = 0; i < 4; ++i)
+		{
+			RayCastHit hit;
+			bool closest = collisions->RayCastClosest(rays[i], 8.0f, 0xFFFFFFFF, &hit);
+			ok = ok && closest && hit.mCollider == &scene.mBodies[i]->mCollider;
+			ok = ok && collisions->RayCastAll(rays[i], 8.0f, 0xFFFFFFFF, &hit, 1) == 1;
+			ok = ok && hits[i].mCollider == &scene.mBodies[i]->mCollider;
+			if (i < 3)
+				ok = ok && fabsf(hits[i].mTime - expected[i]) < 0.001f;
+			if (!ok)
+			{
+				fprintf(stderr, "ray query %u missed its body\n", i);
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	u32 frames = 300, threads = 0, count = 0;
+	const char * sceneName = NULL;
+	const char * outPath = NULL;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (!strcmp(argv[i], "-frames"))
+			frames = static_cast<u32>(atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "-threads"))
+			threads = static_cast<u32>(atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "-count"))
+			count = static_cast<u32>(atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "-scene"))
+			sceneName = argv[i + 1];
+		else if (!strcmp(argv[i], "-out"))
+			outPath = argv[i + 1];
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (!frames)
+		frames = 1;
+	if (!CheckQueries())
+		return 1;
+
+	json results = json::array();
+	for (u32 s = 0; s < sizeof(gScenes) / sizeof(gScenes[0]); ++s)
+	{
+		if (sceneName && strcmp(sceneName, gScenes[s].mName))
+			continue;
+		for (u32 c = 0; c < sizeof(gCounts) / sizeof(gCounts[0]); ++c)
+		{
+			if (count && c)
+				break;
+			u32 bodies = count ? count : gCounts[c];
+			fprintf(stderr, "%s %u bodies...\n", gScenes[s].mName, bodies);
+			results.push_back(RunScene(gScenes[s], bodies, frames, threads));
+		}
+	}
+
+	json integrator = json::array();
+	for (u32 c = 0; c < sizeof(gIntegratorCounts) / sizeof(gIntegratorCounts[0]); ++c)
+	{
+		if ((sceneName && strcmp(sceneName, "integrator")) || (count && c))
+			break;
+		u32 bodies = count ? count : gIntegratorCounts[c];
+		fprintf(stderr, "integrator %u bodies...\n", bodies);
+		integrator.push_back(RunIntegrator(bodies, frames, threads));
+	}
+	aexPhysics->Shutdown();
+	aexJobs->Shutdown();
+
+	json report;
+	report["benchmark"] = "physics";
+	report["fixed_time_step"] = aexPhysics->mFixedTimeStep;
+	report["results"] = results;
+	report["integrator"] = integrator;
+
+	if (outPath)
+	{
+		std::ofstream file(outPath);
+		if (!file.is_open())
+		{
+			fprintf(stderr, "can't open %s\n", outPath);
+			return 1;
+		}
+		file << report.dump(2) << std::endl;
+	}
+	else
+		std::cout << report.dump(2) << std::endl;
+	return 0;
+}
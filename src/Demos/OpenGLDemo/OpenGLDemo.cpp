@@ -2,12 +2,21 @@
 #include "src\Engine\Logic\AEXGameState.h"
 #include "src\Engine\Graphics\GfxMgr.h"
 #include "src\Engine\Graphics\WindowMgr.h"
+#include "src\Engine\Graphics\RenderPipeline.h"
+#include "src\Engine\Core\AEXScheduler.h"
 #include "OpenGLDemo.h"
 
 void OpenGLDemo::Initialize()
 {
+	// draw on a render thread while the next frame is simulated
+	RenderPipe->SetPipelined(true);
+
 	ObjMgr->Initialize();
 	ObjMgr->CreateGO("lol");
+
+	// updated by the engine every frame, after this game state
+	aexScheduler->AddSystem(GfxMgr);
+	aexScheduler->AddSystem(WindowMgr);
 }
 
 void OpenGLDemo::LoadResources()
@@ -17,8 +26,6 @@ void OpenGLDemo::LoadResources()
 
 void OpenGLDemo::Update()
 {
-	GfxMgr->Update();
-	WindowMgr->Update();
 }
 
 void OpenGLDemo::Render()
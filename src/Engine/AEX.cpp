@@ -1,8 +1,27 @@
 #include "AEX.h"
+#include "Physics\AEXCollisionSystem.h"
+#include "Logic\AEXScript.h"
 namespace AEX{
 	AEXEngine::AEXEngine(){}
 	AEXEngine::~AEXEngine()
 	{
+		aexScheduler->Shutdown();
+		SystemScheduler::ReleaseInstance();
+		aexPhysics->Shutdown();
+		PhysicsSystem::ReleaseInstance();
+		CollisionSystem::ReleaseInstance();
+		aexScene->Shutdown();
+		SceneGraph::ReleaseInstance();
+		aexScripts->Shutdown();
+		ScriptScheduler::ReleaseInstance();
+		aexTimers->Shutdown();
+		TimerWheel::ReleaseInstance();
+		aexEvents->Shutdown();
+		EventBus::ReleaseInstance();
+		aexFrameMem->Shutdown();
+		FrameMemory::ReleaseInstance();
+		aexJobs->Shutdown();
+		JobSystem::ReleaseInstance();
 		FRC::ReleaseInstance();
 		Input::ReleaseInstance();
 		WindowManager::ReleaseInstance();
@@ -12,10 +31,24 @@ namespace AEX{
 		// note, here'were creating and initializing at the same
 		// time. by typing the maccro, we're creating the singleton
 		// pointer which is returned, we then call initialize on it.
+		if (!aexJobs->Initialize())return false;	// first, the other systems can use it
+		if (!aexFrameMem->Initialize())return false;	// one arena per job thread
+		if (!aexEvents->Initialize())return false;
+		if (!aexScripts->Initialize())return false;	// after the bus, it subscribes to it
 		if (!aexInput->Initialize())return false;
 		if (!aexTime->Initialize())return false;
+		if (!aexTimers->Initialize())return false;	// driven by the frame time
+		if (!aexPhysics->Initialize())return false;
+		if (!aexScene->Initialize())return false;
+		if (!aexScheduler->Initialize())return false;
 
-		// Frame rate controller options.
+		// updated every frame by the scheduler, in this order when they
+		// conflict (see ISystem::DeclareAccess)
+		aexScheduler->AddSystem(aexPhysics);	// fixed steps: integration + collisions
+		aexScheduler->AddSystem(aexScene);		// world matrices of the moved subtrees
+
+		// Frame rate controller options. The physics runs at its own fixed
+		// step (see PhysicsSystem), it doesn't depend on this lock.
 		aexTime->LockFrameRate(true);
 		aexTime->SetMaxFrameRate(60.0);
 
@@ -42,11 +75,12 @@ namespace AEX{
 			//aexWindowMgr->GetMainWindow()->Exists())
 		{
 			aexTime->StartFrame();
+			aexFrameMem->StartFrame();	// the transient data of the last frame is gone
+			aexTimers->Update();		// the timers due this frame, in one batch
 			//aexInput->Update();			// Process Input specific messages. 
-			// 
-			// TODO: add physics, collisions, interpolations, etc...
-			// 
 			gameState->Update();
+			aexScheduler->Update();		// the engine systems (physics, scene...)
+			aexEvents->Dispatch();		// what they published, on this thread
 			gameState->Render(); 
 			aexTime->EndFrame();
 
@@ -3,11 +3,17 @@
 
 #include "Debug\MyDebug.h"
 #include "Core\AEXCore.h"
+#include "Core\AEXJobSystem.h"
+#include "Core\AEXFrameMemory.h"
+#include "Core\AEXEventBus.h"
+#include "Core\AEXTimerWheel.h"
+#include "Core\AEXScheduler.h"
 #include "Platform\AEXPlatform.h"
 #include "Composition\AEXComposition.h"
 #include "Components\AEXTransformComp.h"
 #include "Logic\AEXGameState.h"
 #include "Logic\AEXLogic.h"
+#include "Physics\AEXPhysicsSystem.h"
 #include "Utilities\AEXUtils.h"
 
 
@@ -3,16 +3,100 @@
 #include "../Composition/AEXGameObject.h"
 #include "AEXCollider.h"
 #include "AEXComponents.h"
+#include "../Physics/AEXCollisionSystem.h"
 #include "../Imgui/imgui.h"
 
 namespace AEX
 {
+	void Collider::Initialize()
+	{
+		CollisionSystem::Instance()->AddRigidBody(this, DynamicState == Dynamic);
+	}
+
+	void Collider::Shutdown()
+	{
+		CollisionSystem::Instance()->RemoveRigidBody(this);
+	}
+
 	void Collider::Update()
 	{
-		if (mCollisionShape == CSHAPE_AABB && (int)(GetTransformComp->mLocal.mOrientation) % 90)
-			mCollisionShape = CSHAPE_OBB;
-		else if (mCollisionShape == CSHAPE_OBB && (int)(GetTransformComp->mLocal.mOrientation) % 90 == 0)
-			mCollisionShape = CSHAPE_AABB;
+		UpdateShapeClass();
+	}
+
+	void Collider::SetDynamicState(EDynamicState state)
+	{
+		if (state == DynamicState)
+			return;
+		DynamicState = state;
+
+		if (mbRegistered)
+		{
+			CollisionSystem * collisions = CollisionSystem::Instance();
+			collisions->RemoveRigidBody(this);
+			collisions->AddRigidBody(this, state == Dynamic);
+		}
+	}
+
+	void Collider::UpdateShapeClass()
+	{
+		if (!mTransform || (mCollisionShape != CSHAPE_AABB && mCollisionShape != CSHAPE_OBB))
+			return;
+
+		const u32 version = mTransform->GetVersion();
+		if (mbShapeClassified && version == mClassifiedVersion)
+			return;
+		mClassifiedVersion = version;
+		mbShapeClassified = true;
+
+		// at 0 or 180 degrees the extents on the axes are the box ones, the 
+		// AABB tests are exact (the orientation is in radians)
+		mCollisionShape = fabsf(mTransform->GetSin()) < 0.0001f ? CSHAPE_AABB : CSHAPE_OBB;
+	}
+
+	void Collider::SetPolygon(const Polygon2D & polygon)
+	{
+		mPolygon = polygon;
+		mbWorldVerticesDirty = true;
+	}
+
+	void Collider::UpdateWorldVertices()
+	{
+		if (!mTransform)
+			return;
+
+		const u32 version = mTransform->GetVersion();
+		if (!mbWorldVerticesDirty && version == mWorldVersion)
+			return;
+
+		mWorldTransform = mTransform->mLocal;
+		mWorldVersion = version;
+		mbWorldVerticesDirty = false;
+
+		// same size every time, only allocates when the polygon changes
+		const u32 count = mPolygon.GetSize();
+		mWorldVertices.resize(count);
+		mWorldNormals.resize(count);
+		if (!count)
+			return;
+		mPolygon.GetTransformedVertices(mTransform->GetModelToWorld(), &mWorldVertices[0]);
+
+		// the winding (and a negative scale) decides where outside is
+		f32 area = 0.0f;
+		for (u32 i = 0; i < count; ++i)
+		{
+			const AEVec2 & a = mWorldVertices[i];
+			const AEVec2 & b = mWorldVertices[(i + 1) % count];
+			area += a.x * b.y - a.y * b.x;
+		}
+		const f32 side = area >= 0.0f ? 1.0f : -1.0f;
+
+		for (u32 i = 0; i < count; ++i)
+		{
+			AEVec2 edge = mWorldVertices[(i + 1) % count] - mWorldVertices[i];
+			AEVec2 normal(edge.y * side, -edge.x * side);
+			f32 length = sqrtf(normal * normal);
+			mWorldNormals[i] = length > 0.0f ? normal * (1.0f / length) : AEVec2(0.0f, 0.0f);
+		}
 	}
 
 	json & Collider::operator<<(json & j) const
@@ -20,6 +104,18 @@ namespace AEX
 		j["isGhost"] << IsGhost;
 		j["collisionShape"] << mCollisionShape;
 		j["dynamicState"] << DynamicState;
+		j["category"] << static_cast<int>(mCategory);
+		j["mask"] << static_cast<int>(mMask);
+		if (mCollisionShape == CSHAPE_POLYGON)
+		{
+			json & vertices = j["polygon"];
+			for (u32 i = 0; i < mPolygon.GetSize(); ++i)
+			{
+				json vtx;
+				vtx << mPolygon[i];
+				vertices.push_back(vtx);
+			}
+		}
 		return j;
 	}
 
@@ -28,9 +124,40 @@ namespace AEX
 		if (j.find("isGhost") != j.end())
 			j["isGhost"] >> IsGhost;
 		if (j.find("collisionShape") != j.end())
+		{
 			j["collisionShape"] >> mCollisionShape;
+			mbShapeClassified = false;
+		}
 		if (j.find("dynamicState") != j.end())
-			j["dynamicState"] >> DynamicState;
+		{
+			int state;
+			j["dynamicState"] >> state;
+			SetDynamicState(static_cast<EDynamicState>(state));
+		}
+
+		// stored as int (the json helpers have no unsigned version)
+		int bits;
+		if (j.find("category") != j.end())
+		{
+			j["category"] >> bits;
+			mCategory = static_cast<u32>(bits);
+		}
+		if (j.find("mask") != j.end())
+		{
+			j["mask"] >> bits;
+			mMask = static_cast<u32>(bits);
+		}
+		if (j.find("polygon") != j.end())
+		{
+			Polygon2D polygon;
+			for (u32 i = 0; i < j["polygon"].size(); ++i)
+			{
+				AEVec2 vtx;
+				j["polygon"][i] >> vtx;
+				polygon.AddVertex(vtx);
+			}
+			SetPolygon(polygon);
+		}
 	}
 
 	std::ostream & Collider::operator<<(std::ostream & o) const
@@ -40,6 +167,23 @@ namespace AEX
 		return o << j;
 	}
 
+	// one checkbox per layer, 8 per row
+	static void LayerBitsGui(const char * name, u32 * bits)
+	{
+		if (ImGui::TreeNode(name))
+		{
+			for (u32 i = 0; i < 32; ++i)
+			{
+				char label[8];
+				sprintf_s(label, sizeof(label), "%u", i);
+				ImGui::CheckboxFlags(label, bits, 1u << i);
+				if ((i + 1) % 8)
+					ImGui::SameLine();
+			}
+			ImGui::TreePop();
+		}
+	}
+
 	void Collider::OnGui()
 	{
 		if (ImGui::CollapsingHeader("Collider"))
@@ -48,18 +192,33 @@ namespace AEX
 			ImGui::Checkbox("IsGhost", &IsGhost);
 
 			ImGui::Text("Collision Shape");
-			static int cShape = CSHAPE_AABB;
-			// @WARNING : might set directly to AABB or OBB, just in case I added OBB
-			ImGui::RadioButton("AABB", &cShape, CSHAPE_AABB); ImGui::SameLine();
-			ImGui::RadioButton("OBB", &cShape, CSHAPE_OBB); ImGui::SameLine();
-			ImGui::RadioButton("Circle", &cShape, CSHAPE_CIRCLE); 
-			mCollisionShape = static_cast<ECollisionShape>(cShape);
+			// AABB and OBB are the same for the user, see UpdateShapeClass
+			int cShape = mCollisionShape;
+			bool changed = ImGui::RadioButton("AABB", &cShape, CSHAPE_AABB); ImGui::SameLine();
+			changed |= ImGui::RadioButton("OBB", &cShape, CSHAPE_OBB); ImGui::SameLine();
+			changed |= ImGui::RadioButton("Circle", &cShape, CSHAPE_CIRCLE); ImGui::SameLine();
+			changed |= ImGui::RadioButton("Polygon", &cShape, CSHAPE_POLYGON);
+			if (changed)
+			{
+				mCollisionShape = static_cast<ECollisionShape>(cShape);
+				mbShapeClassified = false;
+			}
+
+			if (mCollisionShape == CSHAPE_POLYGON)
+			{
+				int sides = mPolygon.GetSize();
+				if (ImGui::SliderInt("Sides", &sides, 3, 16))
+					SetPolygon(Polygon2D::MakeStandardPoly(sides));
+			}
 
 			ImGui::Text("Dynamic State");
-			static int dState = Dynamic;
+			int dState = DynamicState;
 			ImGui::RadioButton("Dynamic", &dState, Dynamic); ImGui::SameLine();
 			ImGui::RadioButton("Static", &dState, Static); 
-			DynamicState = static_cast<EDynamicState>(dState);
+			SetDynamicState(static_cast<EDynamicState>(dState));
+
+			LayerBitsGui("Category", &mCategory);
+			LayerBitsGui("Mask", &mMask);
 
 			/*static ImGuiComboFlags cShape_flags = 0;
 			const char* cShape_items[] = { "Box", "Circle" };
@@ -1,13 +1,18 @@
 #pragma once
+#include "../Math/Polygon2D.h"
 
 namespace AEX
 {
+	class TransformComp;
+	struct RigidBody;
+
 	enum ECollisionShape
 	{
 		CSHAPE_AABB = 1,	// 001
 		CSHAPE_CIRCLE = 2,	// 010
 		CSHAPE_OBB = 4,	// 100
-		CSHAPE_INDEX_MAX = (CSHAPE_OBB | CSHAPE_CIRCLE) + 1
+		CSHAPE_POLYGON = 8,	// 1000
+		CSHAPE_INDEX_MAX = (CSHAPE_POLYGON | CSHAPE_OBB) + 1
 	};
 
 	enum EDynamicState
@@ -28,9 +33,56 @@ namespace AEX
 		ECollisionShape  mCollisionShape = CSHAPE_AABB;
 		EDynamicState DynamicState = Dynamic;
 
+		// Collision filtering: bit i of mCategory puts the collider in layer i,
+		// mMask are the layers it wants to collide with. Both colliders have to
+		// accept each other (and the layer matrix of the CollisionSystem too).
+		u32 mCategory = 0x1;
+		u32 mMask = 0xFFFFFFFF;
+
+		// Convex polygon of CSHAPE_POLYGON, in local space (transformed by the
+		// TransformComp like Polygon2D::MakeQuad). Change it with SetPolygon.
+		Polygon2D mPolygon = Polygon2D::MakeQuad();
+
 		// member variables (not serialized)
-		bool mbHasCollided;							// check if has collided
-		std::vector<Collider *> mCollidedWith;	// if it did, what did it collide with
+		// (the contacts are reported as events, see CollisionSystem::AddEventListener)
+
+		// Set by the CollisionSystem on the main thread before each step, so the
+		// narrowphase workers never have to go through GetOwner()->GetComp().
+		TransformComp *	mTransform = nullptr;
+		RigidBody *		mRigidBody = nullptr;
+		u32				mColliderID = 0;		// unique, assigned on registration. Used for pair keys.
+		bool			mbDynamic = false;		// registered as a dynamic body (static ones have infinite mass)
+		u32				mSolverIndex = 0;		// scratch, index of the body in the island arrays of the step
+		u32				mFilterMask = 0xFFFFFFFF;	// mMask combined with the layer matrix, see CanCollide
+		bool			mbRegistered = false;	// in the CollisionSystem (AddRigidBody/RemoveRigidBody)
+
+		// TransformComp version the box was last classified with, see UpdateShapeClass
+		u32				mClassifiedVersion = 0;
+		bool			mbShapeClassified = false;
+
+		// World space polygon (CSHAPE_POLYGON), see UpdateWorldVertices.
+		std::vector<AEVec2>	mWorldVertices;
+		std::vector<AEVec2>	mWorldNormals;		// outward normal of the edge i -> i + 1
+		Transform			mWorldTransform;	// transform the world vertices were computed with
+		u32					mWorldVersion = 0;	// and its TransformComp version
+		bool				mbWorldVerticesDirty = true;
+
+		void SetPolygon(const Polygon2D & polygon);
+
+		// register in the CollisionSystem, as dynamic or static (DynamicState)
+		void Initialize();
+		void Shutdown();
+
+		// Moves a registered collider between the dynamic and static bodies.
+		void SetDynamicState(EDynamicState state);
+
+		// Boxes aligned with the axes are CSHAPE_AABB, rotated ones CSHAPE_OBB.
+		// Only recomputed when the transform changes. Main thread only.
+		void UpdateShapeClass();
+
+		// Recomputes the world vertices and normals if the transform (or the
+		// polygon) changed since the last call. Main thread only.
+		void UpdateWorldVertices();
 
 		void Update();
 
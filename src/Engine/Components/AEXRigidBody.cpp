@@ -4,6 +4,7 @@
 #include "..\Composition\AEXGameObject.h"
 #include "..\Components\AEXComponents.h"
 #include "AEXRigidBody.h"
+#include "..\Physics\AEXPhysicsSystem.h"
 #include "../Imgui/imgui.h"
 
 namespace AEX
@@ -22,8 +23,8 @@ namespace AEX
 	/**************************************************************************/
 	void RigidBody::Integrate(f32 timeStep)
 	{
-		// check if the inverse mass is not equal to zero
-		if (mInvMass)
+		// check if the inverse mass is not equal to zero (and the body is awake)
+		if (mInvMass && mbAwake && mTransform)
 		{
 			// Multiply the acceleration by the inverse mass
 			mAcceleration *= mInvMass;
@@ -31,7 +32,7 @@ namespace AEX
 			Velocity += mAcceleration * timeStep;
 			// Decrement the RigidBody's velocity depending on its drag
 			Velocity *= LinearDrag;
-			GetTransformComp->mLocal.mTranslation += Velocity * timeStep; // Increment the RigidBody position by the velocity and timeStep
+			mTransform->mLocal.mTranslation += Velocity * timeStep; // Increment the RigidBody position by the velocity and timeStep
 			// Reset the acceleration to (0, 0)
 			mAcceleration = AEVec2();
 		}
@@ -51,26 +52,119 @@ namespace AEX
 	/**************************************************************************/
 	void RigidBody::AddForce(AEVec2 force)
 	{
+		SetAwake(true);
 		mAcceleration += force;
 	}
 
 	/**************************************************************************/
 	/*!
 	  \fn    
-	    Update
+	    SetAwake
+	
+	  \brief 
+	    Wakes up the body or puts it to sleep. Sleeping bodies lose their
+	    velocity and accumulated forces.
+	
+	  \param awake
+	    The new state.
+	*/
+	/**************************************************************************/
+	void RigidBody::SetAwake(bool awake)
+	{
+		if (awake)
+		{
+			if (!mbAwake)
+				mSleepTime = 0.0f;
+		}
+		else
+		{
+			Velocity = AEVec2();
+			AngularVelocity = 0.0f;
+			mAcceleration = AEVec2();
+			mSleepTime = 0.0f;
+		}
+		mbAwake = awake;
+	}
+
+	/**************************************************************************/
+	/*!
+	  \fn    
+	    Initialize
+	
+	  \brief 
+	    Registers the body in the PhysicsSystem.
+	*/
+	/**************************************************************************/
+	void RigidBody::Initialize()
+	{
+		mTransform = GetTransformComp;
+		if (mTransform)
+			mPrevious = mTransform->mLocal;
+		PhysicsSystem::Instance()->AddRigidBody(this);
+	}
+
+	void RigidBody::Shutdown()
+	{
+		PhysicsSystem::Instance()->RemoveRigidBody(this);
+	}
+
+	/**************************************************************************/
+	/*!
+	  \fn    
+	    Step
 	
 	  \brief 
-	    Updates function for the RigidBody
+	    Adds the gravity and integrates this body alone. The PhysicsSystem
+	    integrates all the bodies at once in PhysicsSystem::IntegrateBodies,
+	    which must stay equivalent to this.
+	
+	  \param timeStep
+	    The length of the (sub)step.
 	*/
 	/**************************************************************************/
-	void RigidBody::Update()
+	void RigidBody::Step(f32 timeStep)
 	{
+		// start of the CCD sweep
+		if (mTransform)
+			mStepStart = mTransform->mLocal.mTranslation;
+
+		// sleeping bodies don't move
+		if (!mbAwake)
+			return;
+
+		// Mass may have been changed from the editor/serialization
+		UpdateInvMass();
+
 		// add gravity
 		if (mInvMass)
 			AddForce(Gravity / mInvMass);
 
 		// Integrate physics
-		Integrate(0.16667f);
+		Integrate(timeStep);
+	}
+
+	/**************************************************************************/
+	/*!
+	  \fn    
+	    GetInterpolatedTransform
+	
+	  \brief 
+	    Blends the transform before the last step with the current one, so the
+	    rendering is smooth when the frame rate and the physics rate differ.
+	
+	  \param alpha
+	    PhysicsSystem::GetInterpolationAlpha()
+	*/
+	/**************************************************************************/
+	Transform RigidBody::GetInterpolatedTransform(f32 alpha) const
+	{
+		if (!mTransform)
+			return mPrevious;
+
+		Transform result = mTransform->mLocal;
+		result.mTranslation = mPrevious.mTranslation + (result.mTranslation - mPrevious.mTranslation) * alpha;
+		result.mOrientation = mPrevious.mOrientation + (result.mOrientation - mPrevious.mOrientation) * alpha;
+		return result;
 	}
 
 	json & RigidBody::operator<<(json & j) const
@@ -80,6 +174,7 @@ namespace AEX
 		j["angularVelocity"] << AngularVelocity;
 		j["mass"] << Mass;
 		j["linearDrag"] << LinearDrag;
+		j["isBullet"] << IsBullet;
 		return j;
 	}
 
@@ -95,6 +190,8 @@ namespace AEX
 			j["mass"] >> Mass;
 		if (j.find("linearDrag") != j.end())
 			j["linearDrag"] >> LinearDrag;
+		if (j.find("isBullet") != j.end())
+			j["isBullet"] >> IsBullet;
 	}
 
 	std::ostream & RigidBody::operator<<(std::ostream & o) const
@@ -124,6 +221,8 @@ namespace AEX
 			
 			ImGui::Text("Linear Drag");
 			ImGui::InputFloat("Linear Drag", &LinearDrag);
+
+			ImGui::Checkbox("IsBullet", &IsBullet);
 		}
 	}
 }
@@ -1,6 +1,8 @@
 #pragma once
 #include "src\Engine\Composition\AEXSerialization.h"
 
+namespace AEX { class TransformComp; }
+
 namespace AEX
 {
 	/****************************************************************
@@ -8,15 +10,16 @@ namespace AEX
 
 		- Dependencies :	Transform
 							Collider ?
+		- Integrated at a fixed time step by the PhysicsSystem
 		- @TODO :
-			1) substitute on Update() 0.16667f to gAEFrameTime
-			2) (Optional) Implement AngularVelocity
+			1) (Optional) Implement AngularVelocity
 	****************************************************************/
 	struct RigidBody : public IComp
 	{
 		AEX_RTTI_DECL(RigidBody, IComp);
 
 		friend class CollisionSystem;
+		friend class PhysicsSystem;
 
 		// Properties (Public members)
 		AEVec2			 Gravity;
@@ -24,15 +27,39 @@ namespace AEX
 		f32				 AngularVelocity = 0.0f;
 		f32				 Mass = 1.0f;
 		f32				 LinearDrag = 0.990f;
+		bool			 IsBullet = false;	// always use continuous collision (CollisionSystem CCD)
+
+		RigidBody() : IComp(), mInvMass(1.0f), mbAwake(true), mSleepTime(0.0f) {}
+
+		// Set by the PhysicsSystem before each step
+		TransformComp *	mTransform = nullptr;
+		Transform		mPrevious;		// transform before the last step (render interpolation)
+		AEVec2			mStepStart;		// position before the last integration (CCD sweep start)
+		u32				mPhysicsIndex = 0xFFFFFFFF;	// slot in the PhysicsSystem, none if not registered
 
-		RigidBody() : IComp() {}
+		// register in the PhysicsSystem
+		void Initialize();
+		void Shutdown();
 
 		// adding force
 		void AddForce(AEVec2 force);
 		// Integrate Euler
 		void Integrate(f32 timeStep);
-		// Update
-		void Update();
+		// Gravity + integration of this body alone. The PhysicsSystem does the
+		// same for all the bodies at once (PhysicsSystem::IntegrateBodies).
+		void Step(f32 timeStep);
+
+		// Transform between mPrevious (alpha = 0) and the current one (alpha = 1)
+		Transform GetInterpolatedTransform(f32 alpha) const;
+
+		// Inverse mass, refreshed from Mass (0 = infinite mass)
+		void UpdateInvMass() { mInvMass = Mass > 0.0f ? 1.0f / Mass : 0.0f; }
+		f32  GetInvMass() const { return mInvMass; }
+
+		// Sleeping bodies don't integrate nor collide until something touches
+		// them (see CollisionSystem islands). Forces wake the body up.
+		bool IsAwake() const { return mbAwake; }
+		void SetAwake(bool awake);
 
 		// Serialization
 		json& operator<<(json&j)  const;
@@ -45,5 +72,7 @@ namespace AEX
 	private:
 		AEVec2	mAcceleration;
 		f32		mInvMass;
+		bool	mbAwake;
+		f32		mSleepTime;		// time spent below the sleep tolerances
 	};
 }
\ No newline at end of file
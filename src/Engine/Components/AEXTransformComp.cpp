@@ -1,4 +1,6 @@
 #include "AEXTransformComp.h"
+#include "../Math/SimdMath.h"
+#include "../Composition/AEXSceneGraph.h"
 #include "../Composition/AEXSerialization.h"
 #include "../Imgui/imgui.h"
 
@@ -9,13 +11,33 @@ namespace AEX
 
 	// --------------------------------------------------------------------
 	TransformComp::TransformComp()
+		: mbSynced(false)
+		, mVersion(0)
+		, mSin(0.0f)
+		, mCos(1.0f)
+		, mValidMatrices(0)
+		, mParent(NULL)
+		, mChildCount(0)
+		, mSceneNode(SceneGraph::INVALID_NODE)
 	{
-		
+		mAxes[0] = AEVec2(1.0f, 0.0f);
+		mAxes[1] = AEVec2(0.0f, 1.0f);
 	}
 	// --------------------------------------------------------------------
 	TransformComp::~TransformComp()
 	{
 		
+	}
+	// --------------------------------------------------------------------
+	void TransformComp::Initialize()
+	{
+		aexScene->AddNode(this);
+	}
+	// --------------------------------------------------------------------
+	void TransformComp::Shutdown()
+	{
+		aexScene->RemoveNode(this);
+		SetParent(NULL);
 	}
 	// --------------------------------------------------------------------
 	f32 TransformComp::GetRotationAngle()
@@ -46,6 +68,42 @@ namespace AEX
 
 	}
 	// --------------------------------------------------------------------
+	bool TransformComp::SetParent(TransformComp * parent)
+	{
+		if (parent == mParent)
+			return true;
+
+		// no cycles
+		for (TransformComp * ancestor = parent; ancestor; ancestor = ancestor->mParent)
+		{
+			if (ancestor == this)
+				return false;
+		}
+
+		if (mParent)
+			mParent->mChildCount--;
+		mParent = parent;
+		if (mParent)
+			mParent->mChildCount++;
+
+		if (mSceneNode != SceneGraph::INVALID_NODE)
+			aexScene->mbOrderDirty = true;
+		return true;
+	}
+	// --------------------------------------------------------------------
+	const AEMtx33 & TransformComp::GetLocalToWorld()
+	{
+		if (mSceneNode == SceneGraph::INVALID_NODE)
+			return GetModelToWorld();
+		return aexScene->GetWorldMatrix(this);
+	}
+	// --------------------------------------------------------------------
+	AEVec2 TransformComp::GetWorldPosition()
+	{
+		const AEMtx33 & world = GetLocalToWorld();
+		return AEVec2(world.m[0][2], world.m[1][2]);
+	}
+	// --------------------------------------------------------------------
 	void TransformComp::SetDirection(AEVec2 dir)
 	{
 		mLocal.mOrientation = RadToDeg(dir.GetAngle());
@@ -94,30 +152,88 @@ namespace AEX
 	}*/
 
 	// --------------------------------------------------------------------
-	AEMtx33 TransformComp::GetModelToWorld()
+	bool TransformComp::Sync()
 	{
-		return mLocal.GetMatrix();
+		const Transform & tr = mLocal;
+		if (mbSynced &&
+			tr.mTranslation.x == mSyncedLocal.mTranslation.x && tr.mTranslation.y == mSyncedLocal.mTranslation.y &&
+			tr.mTranslationZ.x == mSyncedLocal.mTranslationZ.x && tr.mTranslationZ.y == mSyncedLocal.mTranslationZ.y &&
+			tr.mTranslationZ.z == mSyncedLocal.mTranslationZ.z &&
+			tr.mScale.x == mSyncedLocal.mScale.x && tr.mScale.y == mSyncedLocal.mScale.y &&
+			tr.mOrientation == mSyncedLocal.mOrientation)
+			return false;
+
+		// the physics moves the bodies every step, only recompute the 
+		// trigonometry when the orientation changed
+		if (!mbSynced || tr.mOrientation != mSyncedLocal.mOrientation)
+		{
+			mCos = cosf(tr.mOrientation);
+			mSin = sinf(tr.mOrientation);
+			mAxes[0] = AEVec2(mCos, mSin);
+			mAxes[1] = AEVec2(-mSin, mCos);
+		}
+
+		mSyncedLocal = tr;
+		mbSynced = true;
+		mValidMatrices = 0;
+		++mVersion;
+		return true;
+	}
+	// --------------------------------------------------------------------
+	u32 TransformComp::GetVersion()
+	{
+		Sync();
+		return mVersion;
+	}
+	// --------------------------------------------------------------------
+	const AEMtx33 & TransformComp::GetModelToWorld()
+	{
+		Sync();
+		if (!(mValidMatrices & CMTX_MODEL_TO_WORLD))
+		{
+			Simd::AsSimd(mModelToWorld) = Simd::Mtx33::FromTransform(Simd::AsSimd(mLocal.mTranslation), Simd::AsSimd(mLocal.mScale), mSin, mCos);
+			mValidMatrices |= CMTX_MODEL_TO_WORLD;
+		}
+		return mModelToWorld;
 	}
 	// --------------------------------------------------------------------
-	AEMtx33 TransformComp::GetWorldToModel()
+	const AEMtx33 & TransformComp::GetWorldToModel()
 	{
-		return mLocal.GetInvMatrix();
+		Sync();
+		if (!(mValidMatrices & CMTX_WORLD_TO_MODEL))
+		{
+			Simd::AsSimd(mWorldToModel) = Simd::Mtx33::FromInvTransform(Simd::AsSimd(mLocal.mTranslation), Simd::AsSimd(mLocal.mScale), mSin, mCos);
+			mValidMatrices |= CMTX_WORLD_TO_MODEL;
+		}
+		return mWorldToModel;
 	}
 	// --------------------------------------------------------------------
-	AEMtx44 TransformComp::GetModelToWorld4x4()
+	const AEMtx44 & TransformComp::GetModelToWorld4x4()
 	{
-		AEMtx44 scale_mtx = AEMtx44::Scale(mLocal.mScale.x, mLocal.mScale.y, 1.0f);
-		AEMtx44 rot_mtx = AEMtx44::RotateXYZ(0, 0, mLocal.mOrientation);
-		AEMtx44 trans_mtx = AEMtx44::Translate(mLocal.mTranslationZ.x, mLocal.mTranslationZ.y, mLocal.mTranslationZ.z);
-		return (trans_mtx * rot_mtx * scale_mtx);
+		Sync();
+		if (!(mValidMatrices & CMTX_MODEL_TO_WORLD_4X4))
+		{
+			AEMtx44 scale_mtx = AEMtx44::Scale(mLocal.mScale.x, mLocal.mScale.y, 1.0f);
+			AEMtx44 rot_mtx = AEMtx44::RotateXYZ(0, 0, mLocal.mOrientation);
+			AEMtx44 trans_mtx = AEMtx44::Translate(mLocal.mTranslationZ.x, mLocal.mTranslationZ.y, mLocal.mTranslationZ.z);
+			Simd::Store(Simd::Load(trans_mtx) * Simd::Load(rot_mtx) * Simd::Load(scale_mtx), mModelToWorld4x4);
+			mValidMatrices |= CMTX_MODEL_TO_WORLD_4X4;
+		}
+		return mModelToWorld4x4;
 	}
 	// --------------------------------------------------------------------
-	AEMtx44 TransformComp::GetWorldToModel4x4()
+	const AEMtx44 & TransformComp::GetWorldToModel4x4()
 	{
-		AEMtx44 scale_mtx = AEMtx44::Scale(1.0f/mLocal.mScale.x, 1.0f/mLocal.mScale.y, 1.0f);
-		AEMtx44 rot_mtx = AEMtx44::RotateXYZ(0, 0, -mLocal.mOrientation);
-		AEMtx44 trans_mtx = AEMtx44::Translate(-mLocal.mTranslationZ.x, -mLocal.mTranslationZ.y, -mLocal.mTranslationZ.z);
-		return(scale_mtx*rot_mtx*trans_mtx);
+		Sync();
+		if (!(mValidMatrices & CMTX_WORLD_TO_MODEL_4X4))
+		{
+			AEMtx44 scale_mtx = AEMtx44::Scale(1.0f/mLocal.mScale.x, 1.0f/mLocal.mScale.y, 1.0f);
+			AEMtx44 rot_mtx = AEMtx44::RotateXYZ(0, 0, -mLocal.mOrientation);
+			AEMtx44 trans_mtx = AEMtx44::Translate(-mLocal.mTranslationZ.x, -mLocal.mTranslationZ.y, -mLocal.mTranslationZ.z);
+			Simd::Store(Simd::Load(scale_mtx) * Simd::Load(rot_mtx) * Simd::Load(trans_mtx), mWorldToModel4x4);
+			mValidMatrices |= CMTX_WORLD_TO_MODEL_4X4;
+		}
+		return mWorldToModel4x4;
 	}
 
 
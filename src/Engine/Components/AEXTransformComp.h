@@ -15,15 +15,48 @@ namespace AEX
 		TransformComp();
 		virtual ~TransformComp();
 
+		virtual void Initialize();	// registers in the SceneGraph
+		virtual void Shutdown();
+
 		f32 GetRotationAngle();
 		AEVec2 GetDirection();
 		AEVec2 GetPosition();
 		AEVec3 GetPosition3D();
 		AEVec2 GetScale();
-		AEMtx33 GetModelToWorld();
-		AEMtx33 GetWorldToModel();
-		AEMtx44 GetModelToWorld4x4();
-		AEMtx44 GetWorldToModel4x4();
+
+		// Cached, only recomputed when mLocal changes (see Sync)
+		const AEMtx33 & GetModelToWorld();
+		const AEMtx33 & GetWorldToModel();
+		const AEMtx44 & GetModelToWorld4x4();
+		const AEMtx44 & GetWorldToModel4x4();
+
+		// mLocal is written directly (physics, serialization, editor), so the
+		// changes are detected by comparing it with the transform the cache 
+		// was computed from. Sync refreshes the version and the sin/cos and 
+		// axes, the matrices are recomputed on demand. Not thread safe: only
+		// from systems that declare a write of TransformComp.
+		// Returns true if mLocal changed since the last call.
+		bool Sync();
+		u32 GetVersion();	// incremented on every change of mLocal
+
+		// As of the last Sync (don't sync, so the physics workers can use them)
+		f32 GetSin() const { return mSin; }
+		f32 GetCos() const { return mCos; }
+		const AEVec2 & GetAxisX() const { return mAxes[0]; }
+		const AEVec2 & GetAxisY() const { return mAxes[1]; }
+		const AEVec2 * GetAxes() const { return mAxes; }	// x and y, see GetOrientedRectAxes
+
+		// Hierarchy: with a parent, mLocal is relative to the parent transform.
+		// Returns false (and doesn't change anything) if parent is this 
+		// transform or one of its descendants.
+		bool SetParent(TransformComp * parent);
+		TransformComp * GetParent() const { return mParent; }
+		u32 GetChildCount() const { return mChildCount; }
+
+		// World matrix of the SceneGraph (as of its last update), the local one
+		// if the transform isn't registered.
+		const AEMtx33 & GetLocalToWorld();
+		AEVec2 GetWorldPosition();
 
 		void SetDirection(AEVec2 dir);
 		void SetRotationAngle(f32 angle);
@@ -40,6 +73,31 @@ namespace AEX
 		// Data
 	public:
 		Transform mLocal;
+
+	private:
+		enum ECachedMatrix
+		{
+			CMTX_MODEL_TO_WORLD = 1,
+			CMTX_WORLD_TO_MODEL = 2,
+			CMTX_MODEL_TO_WORLD_4X4 = 4,
+			CMTX_WORLD_TO_MODEL_4X4 = 8
+		};
+
+		// derived data of mLocal
+		Transform	mSyncedLocal;		// mLocal when it was last synced
+		bool		mbSynced;
+		u32			mVersion;
+		f32			mSin, mCos;
+		AEVec2		mAxes[2];
+		u32			mValidMatrices;		// ECachedMatrix flags
+		AEMtx33		mModelToWorld, mWorldToModel;
+		AEMtx44		mModelToWorld4x4, mWorldToModel4x4;
+
+		// hierarchy
+		friend class SceneGraph;
+		TransformComp *	mParent;
+		u32				mChildCount;
+		u32				mSceneNode;		// index in the SceneGraph arrays
 	};
 
 
@@ -4,4 +4,5 @@
 #include "AEXSerialization.h"
 #include "AEXComponent.h"
 #include "AEXGameObject.h"
+#include "AEXSceneGraph.h"
 #endif
\ No newline at end of file
@@ -12,7 +12,9 @@
 #include "AEXObjectManager.h"
 #include "../Imgui/imgui.h"
 #include "../Graphics/GfxMgr.h"
+#include "../Graphics/RenderPipeline.h"
 #include "../Core/AEXGlobalVariables.h"
+#include "../Components/AEXTransformComp.h"
 
 #include <./extern/glad/glad.h>
 #include <./extern/glfw/glfw3.h>
@@ -26,7 +28,7 @@ namespace AEX
 	// ----------------------------------------------------------------------------
 	// AEXOBJECT
 
-	GameObject::GameObject() : IBase()
+	GameObject::GameObject() : IBase(), mChildObj(NULL)
 	{
 		char * id_str;
 		std::string ObjectName = GOdefaultName + std::to_string(objectID);
@@ -38,6 +40,26 @@ namespace AEX
 	GameObject::~GameObject()
 	{}
 
+	// ----------------------------------------------------------------------------
+	void GameObject::SetChildObj(GameObject* childObj)
+	{
+		TransformComp * tr = GetComp<TransformComp>();
+		if (mChildObj)
+		{
+			TransformComp * oldTr = mChildObj->GetComp<TransformComp>();
+			if (oldTr && oldTr->GetParent() == tr)
+				oldTr->SetParent(NULL);
+		}
+
+		mChildObj = childObj;
+		if (mChildObj)
+		{
+			TransformComp * childTr = mChildObj->GetComp<TransformComp>();
+			if (tr && childTr && !childTr->SetParent(tr))
+				mChildObj = NULL;	// this object is a descendant of the child
+		}
+	}
+
 	// ----------------------------------------------------------------------------
 	#pragma region// STATE METHODS
 	
@@ -60,70 +82,74 @@ namespace AEX
 		FOR_EACH(it, mComps)
 			(*it)->Initialize();
 
-		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-		// Initialize Render data
-		float vertices[] = {
-			// positions          // colors           // texture coords
-			0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f,   // top right
-			0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f,   // bottom right
-			-0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f,   // bottom left
-			-0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f    // top left 
-		};
-		unsigned int indices[] = {  // note that we start from 0!
-			0, 1, 3,   // first triangle
-			1, 2, 3    // second triangle
-		};
-
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-		glGenBuffers(1, &EBO);
-
-		// ..:: Initialization code :: ..
-		// 1. bind Vertex Array Object
-		glBindVertexArray(VAO);
-		// 2. copy our vertices array in a vertex buffer for OpenGL to use
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-		// 3. copy our index array in a element buffer for OpenGL to use
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-		// 4. then set the vertex attributes pointers
-		// position attribute
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-		// color attribute
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-		glEnableVertexAttribArray(1);
-		// texture coord attribute
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-		glEnableVertexAttribArray(2);
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		// remember: do NOT unbind the EBO while a VAO is active as the bound element buffer object IS stored in the VAO; keep the EBO bound.
-		//glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-		// You can unbind the VAO afterwards so other VAO calls won't accidentally modify this VAO, but this rarely happens. Modifying other
-		// VAOs requires a call to glBindVertexArray anyways so we generally don't unbind VAOs (nor VBOs) when it's not directly necessary.
-		glBindVertexArray(0);
-
-		//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-		// Create a texture
-		mTex = new Texture("data/Images/container.jpg");
+		// GL resources are created on the thread that owns the context
+		RenderPipe->Execute([this]()
+		{
+			//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+			// Initialize Render data
+			float vertices[] = {
+				// positions          // colors           // texture coords
+				0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f,   // top right
+				0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f,   // bottom right
+				-0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f,   // bottom left
+				-0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f    // top left 
+			};
+			unsigned int indices[] = {  // note that we start from 0!
+				0, 1, 3,   // first triangle
+				1, 2, 3    // second triangle
+			};
+
+			glGenVertexArrays(1, &VAO);
+			glGenBuffers(1, &VBO);
+			glGenBuffers(1, &EBO);
+
+			// ..:: Initialization code :: ..
+			// 1. bind Vertex Array Object
+			glBindVertexArray(VAO);
+			// 2. copy our vertices array in a vertex buffer for OpenGL to use
+			glBindBuffer(GL_ARRAY_BUFFER, VBO);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+			// 3. copy our index array in a element buffer for OpenGL to use
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+			// 4. then set the vertex attributes pointers
+			// position attribute
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+			glEnableVertexAttribArray(0);
+			// color attribute
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+			glEnableVertexAttribArray(1);
+			// texture coord attribute
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+			glEnableVertexAttribArray(2);
+			glEnableVertexAttribArray(0);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			// remember: do NOT unbind the EBO while a VAO is active as the bound element buffer object IS stored in the VAO; keep the EBO bound.
+			//glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+			// You can unbind the VAO afterwards so other VAO calls won't accidentally modify this VAO, but this rarely happens. Modifying other
+			// VAOs requires a call to glBindVertexArray anyways so we generally don't unbind VAOs (nor VBOs) when it's not directly necessary.
+			glBindVertexArray(0);
+
+			//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+			// Create a texture
+			mTex = new Texture("data/Images/container.jpg");
+		});
 	}
 
 	void GameObject::Render()
 	{
-		glBindTexture(GL_TEXTURE_2D, mTex->GetID());
-		
 		// create transformations
 		AEMtx44 mtx = AEMtx44::Scale(0.1f, 1.0f, 1.0f) * AEMtx44::Rotate(0.0f, 0.0f, tan((float)glfwGetTime())) * AEMtx44::Translate(1.0f, 0.0f, 0.0f);  // make sure to initialize matrix to identity matrix first
 
-		// get matrix's uniform location and set matrix
-		GfxMgr->mCurrentShader->use();
-		GfxMgr->mCurrentShader->setMat4("transform", mtx);
-
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		// copied into the frame, drawn by RenderPipeline::EndFrame
+		RenderItem item;
+		item.mModelToWorld = mtx;
+		item.mShader = GfxMgr->mCurrentShader->ID;
+		item.mTexture = mTex->GetID();
+		item.mVAO = VAO;
+		item.mIndexCount = 6;
+		RenderPipe->GetFrame().mItems.push_back(item);
 	}
 
 	void GameObject::Shutdown()
@@ -132,9 +158,14 @@ namespace AEX
 		FOR_EACH(it, mComps)
 			(*it)->Shutdown();
 
-		glDeleteVertexArrays(1, &VAO);
-		glDeleteBuffers(1, &VBO);
-		glDeleteBuffers(1, &EBO);
+		// after the frames that still use them
+		unsigned int vao = VAO, vbo = VBO, ebo = EBO;
+		RenderPipe->Post([vao, vbo, ebo]()
+		{
+			glDeleteVertexArrays(1, &vao);
+			glDeleteBuffers(1, &vbo);
+			glDeleteBuffers(1, &ebo);
+		});
 
 		delete mTex;
 	}
@@ -160,8 +191,7 @@ namespace AEX
 		// go throught the components and look for the same type
 		for (auto it = mComps.begin(); it != mComps.end(); ++it)
 		{
-			std::string typeName = (*it)->GetType().GetName();
-			if (typeName == type)
+			if (strcmp((*it)->GetType().GetName(), type) == 0)
 				return (*it);
 		}
 		return NULL;
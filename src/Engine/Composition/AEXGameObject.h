@@ -85,7 +85,7 @@ namespace AEX
 		std::vector<IComp*> &GetComps()  { return mComps; }
 		const std::vector<IComp*> &GetComps() const { return mComps; }
 		GameObject* GetChildObj() { return mChildObj; }
-		void		SetChildObj(GameObject* childObj) { mChildObj = childObj; }
+		void		SetChildObj(GameObject* childObj);	// parents its TransformComp to this one
 
 		void OnGui();
 		// --------------------------------------------------------------------
@@ -0,0 +1,264 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXSceneGraph.cpp
+// Purpose:	Implementation of the transform hierarchy.
+// ----------------------------------------------------------------------------
+#include "AEXSceneGraph.h"
+#include "..\Components\AEXTransformComp.h"
+#include "..\Core\AEXFrameMemory.h"
+#include "..\Math\SimdMath.h"
+#include <algorithm>	// std::reverse
+#include <cassert>
+
+namespace AEX
+{
+	const u32 SceneGraph::INVALID_NODE;
+
+	SceneGraph::SceneGraph() : ISystem()
+		, mbOrderDirty(false)
+		, mbRecomputeAll(false)
+		, mUpdatedLastFrame(0)
+	{}
+
+	bool SceneGraph::Initialize()
+	{
+		mbOrderDirty = true;
+		mUpdatedLastFrame = 0;
+		return true;
+	}
+
+	void SceneGraph::Update()
+	{
+		UpdateWorld();
+	}
+
+	// a write: reading the versions syncs the TransformComp caches
+	void SceneGraph::DeclareAccess(SystemAccess & access)
+	{
+		access.Write<TransformComp>();
+	}
+
+	void SceneGraph::Shutdown()
+	{
+		ClearNodes();
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		AddNode
+	// \brief	Appends the transform, it is moved after its parent on the next
+	//			RebuildOrder. Adding a registered transform again does nothing.
+	// ----------------------------------------------------------------------------
+	void SceneGraph::AddNode(TransformComp * transform)
+	{
+		if (transform->mSceneNode != INVALID_NODE)
+			return;
+
+		transform->mSceneNode = mTransforms.size();
+		mTransforms.push_back(transform);
+		mParent.push_back(INVALID_NODE);
+		mFirstChild.push_back(INVALID_NODE);
+		mNextSibling.push_back(INVALID_NODE);
+		mLocalVersion.push_back(0);
+		mDirty.push_back(1);
+		mWorld.push_back(AEMtx33());
+		mbOrderDirty = true;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		RemoveNode
+	// \brief	Swaps the last node into the removed slot. The children are
+	//			detached (their mLocal is now in world space).
+	// ----------------------------------------------------------------------------
+	void SceneGraph::RemoveNode(TransformComp * transform)
+	{
+		u32 node = transform->mSceneNode;
+		if (node == INVALID_NODE)
+			return;
+
+		transform->SetParent(NULL);
+		if (transform->mChildCount)
+		{
+			FOR_EACH(it, mTransforms)
+			{
+				if ((*it)->mParent == transform)
+					(*it)->SetParent(NULL);
+			}
+		}
+
+		u32 last = mTransforms.size() - 1;
+		if (node != last)
+		{
+			mTransforms[node] = mTransforms[last];
+			mLocalVersion[node] = mLocalVersion[last];
+			mWorld[node] = mWorld[last];
+			mTransforms[node]->mSceneNode = node;
+		}
+		mTransforms.pop_back();
+		mParent.pop_back();
+		mFirstChild.pop_back();
+		mNextSibling.pop_back();
+		mLocalVersion.pop_back();
+		mDirty.pop_back();
+		mWorld.pop_back();
+
+		transform->mSceneNode = INVALID_NODE;
+		mbOrderDirty = true;
+	}
+
+	void SceneGraph::ClearNodes()
+	{
+		FOR_EACH(it, mTransforms)
+			(*it)->mSceneNode = INVALID_NODE;
+		mTransforms.clear();
+		mParent.clear();
+		mFirstChild.clear();
+		mNextSibling.clear();
+		mLocalVersion.clear();
+		mDirty.clear();
+		mWorld.clear();
+		mbOrderDirty = false;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		RebuildOrder
+	// \brief	Sorts the nodes depth first from the TransformComp parent links,
+	//			so every parent is before its children and a subtree is a
+	//			contiguous range. A transform whose parent isn't registered is
+	//			a root. All the world matrices are recomputed on the next pass.
+	// ----------------------------------------------------------------------------
+	void SceneGraph::RebuildOrder()
+	{
+		mbOrderDirty = false;
+		mbRecomputeAll = true;
+
+		u32 count = mTransforms.size();
+		if (!count)
+			return;
+
+		// children lists with the current indices. Built backwards so the
+		// siblings keep the order in which they were added.
+		FrameVector<u32> firstChild(count, INVALID_NODE), nextSibling(count, INVALID_NODE);
+		FrameVector<u32> roots;
+		for (u32 i = count; i-- > 0;)
+		{
+			TransformComp * parent = mTransforms[i]->mParent;
+			if (parent && parent->mSceneNode != INVALID_NODE)
+			{
+				nextSibling[i] = firstChild[parent->mSceneNode];
+				firstChild[parent->mSceneNode] = i;
+			}
+			else
+				roots.push_back(i);
+		}
+
+		// preorder, with an explicit stack (the hierarchies can be deep)
+		FrameVector<u32> order;
+		FrameVector<u32> stack;
+		order.reserve(count);
+		for (u32 r = roots.size(); r-- > 0;)
+		{
+			stack.push_back(roots[r]);
+			while (!stack.empty())
+			{
+				u32 node = stack.back();
+				stack.pop_back();
+				order.push_back(node);
+
+				// pushed in reverse, so the first child is visited first
+				u32 childCount = stack.size();
+				for (u32 c = firstChild[node]; c != INVALID_NODE; c = nextSibling[c])
+					stack.push_back(c);
+				std::reverse(stack.begin() + childCount, stack.end());
+			}
+		}
+		assert(order.size() == count);	// a cycle, TransformComp::SetParent rejects them
+
+		// reorder the node data
+		std::vector<TransformComp*> transforms(count);
+		for (u32 i = 0; i < count; ++i)
+		{
+			transforms[i] = mTransforms[order[i]];
+			transforms[i]->mSceneNode = i;
+		}
+		mTransforms.swap(transforms);
+
+		for (u32 i = 0; i < count; ++i)
+		{
+			TransformComp * parent = mTransforms[i]->mParent;
+			mParent[i] = (parent && parent->mSceneNode != INVALID_NODE) ? parent->mSceneNode : INVALID_NODE;
+			mFirstChild[i] = INVALID_NODE;
+			mNextSibling[i] = INVALID_NODE;
+		}
+		for (u32 i = count; i-- > 0;)
+		{
+			if (mParent[i] != INVALID_NODE)
+			{
+				mNextSibling[i] = mFirstChild[mParent[i]];
+				mFirstChild[mParent[i]] = i;
+			}
+		}
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		UpdateWorld
+	// \brief	One pass in depth first order: a node is recomputed if its
+	//			transform changed or its parent was recomputed in this pass.
+	//			Nodes that didn't move only compare their version.
+	// ----------------------------------------------------------------------------
+	void SceneGraph::UpdateWorld()
+	{
+		if (mbOrderDirty)
+			RebuildOrder();
+
+		mUpdatedLastFrame = 0;
+		u32 count = mTransforms.size();
+		for (u32 i = 0; i < count; ++i)
+		{
+			TransformComp * transform = mTransforms[i];
+			u32 parent = mParent[i];
+			u32 version = transform->GetVersion();
+
+			bool dirty = mbRecomputeAll || version != mLocalVersion[i] || (parent != INVALID_NODE && mDirty[parent]);
+			mDirty[i] = dirty;
+			if (!dirty)
+				continue;
+
+			const AEMtx33 & local = transform->GetModelToWorld();
+			if (parent == INVALID_NODE)
+				mWorld[i] = local;
+			else
+				Simd::AsSimd(mWorld[i]) = Simd::AsSimd(mWorld[parent]) * Simd::AsSimd(local);
+			mLocalVersion[i] = version;
+			mUpdatedLastFrame++;
+		}
+		mbRecomputeAll = false;
+	}
+
+	const AEMtx33 & SceneGraph::GetWorldMatrix(TransformComp * transform)
+	{
+		assert(transform->mSceneNode != INVALID_NODE);
+		if (mbOrderDirty || mbRecomputeAll)
+			UpdateWorld();
+		return mWorld[transform->mSceneNode];
+	}
+
+	TransformComp * SceneGraph::GetFirstChild(TransformComp * transform)
+	{
+		if (transform->mSceneNode == INVALID_NODE)
+			return NULL;
+		if (mbOrderDirty)
+			RebuildOrder();
+		u32 child = mFirstChild[transform->mSceneNode];
+		return child != INVALID_NODE ? mTransforms[child] : NULL;
+	}
+
+	TransformComp * SceneGraph::GetNextSibling(TransformComp * transform)
+	{
+		if (transform->mSceneNode == INVALID_NODE)
+			return NULL;
+		if (mbOrderDirty)
+			RebuildOrder();
+		u32 sibling = mNextSibling[transform->mSceneNode];
+		return sibling != INVALID_NODE ? mTransforms[sibling] : NULL;
+	}
+}
@@ -0,0 +1,85 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXSceneGraph.h
+// Purpose:	Transform hierarchy. The nodes are kept in flat arrays in depth
+//			first order (parents before their children) and the world
+//			matrices are recomputed in one linear pass, only for the nodes
+//			whose transform (or one of whose ancestors) changed.
+// ----------------------------------------------------------------------------
+#ifndef AEX_SCENE_GRAPH_H_
+#define AEX_SCENE_GRAPH_H_
+
+#include "..\Core\AEXCore.h"
+#include <aexmath\AEXMath.h>
+
+namespace AEX
+{
+	class TransformComp;
+
+	// ----------------------------------------------------------------------------
+	// \class	SceneGraph
+	// \brief	Every initialized TransformComp is a node. The parent is set on
+	//			the component (TransformComp::SetParent), the arrays are only
+	//			reordered when the hierarchy changes. Nodes whose local
+	//			transform didn't change cost a version compare per frame.
+	class SceneGraph : public ISystem
+	{
+		AEX_RTTI_DECL(SceneGraph, ISystem);
+		AEX_SINGLETON(SceneGraph);
+
+	public:
+		static const u32 INVALID_NODE = 0xFFFFFFFF;
+
+		// ------------------------------------------------------------------------
+		// System Functions
+		virtual bool Initialize();
+		virtual void Update();		// UpdateWorld, once per frame before rendering
+		virtual void DeclareAccess(SystemAccess & access);
+		void Shutdown();
+
+		// Node Management (TransformComp::Initialize/Shutdown)
+		void AddNode(TransformComp * transform);
+		void RemoveNode(TransformComp * transform);	// its children become roots
+		void ClearNodes();
+
+		// Reorders the arrays if the hierarchy changed and recomputes the world
+		// matrices of the dirty subtrees.
+		void UpdateWorld();
+
+		// World matrix of a node, as of the last UpdateWorld (the arrays are
+		// reordered first if the hierarchy changed since).
+		const AEMtx33 & GetWorldMatrix(TransformComp * transform);
+
+		// Hierarchy traversal (NULL at the end)
+		TransformComp * GetFirstChild(TransformComp * transform);
+		TransformComp * GetNextSibling(TransformComp * transform);
+
+		u32 GetNodeCount() const { return mTransforms.size(); }
+		u32 GetUpdatedLastFrame() const { return mUpdatedLastFrame; }	// world matrices recomputed
+
+	private:
+		friend class TransformComp;		// SetParent flags the order as dirty
+
+		void RebuildOrder();
+
+		// node data, index i is TransformComp::mSceneNode. In depth first order
+		// after RebuildOrder (new nodes are appended until the next one).
+		std::vector<TransformComp*>	mTransforms;
+		std::vector<u32>			mParent;
+		std::vector<u32>			mFirstChild;
+		std::vector<u32>			mNextSibling;
+		std::vector<u32>			mLocalVersion;	// TransformComp::GetVersion the world was computed with
+		std::vector<u8>				mDirty;			// recomputed in this pass (propagates to the children)
+		std::vector<AEMtx33>		mWorld;
+
+		bool						mbOrderDirty;	// nodes added, removed or reparented
+		bool						mbRecomputeAll;	// after reordering
+		u32							mUpdatedLastFrame;
+	};
+}
+
+// Easy access to singleton
+#define aexScene (AEX::SceneGraph::Instance())
+// ---------------------------------------------------------------------------
+
+#endif
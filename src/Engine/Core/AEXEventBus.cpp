@@ -0,0 +1,76 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXEventBus.cpp
+// Purpose:	Implementation of the event bus.
+// ----------------------------------------------------------------------------
+#include "AEXEventBus.h"
+
+namespace AEX
+{
+	const u32 EventBus::MAX_EVENT_TYPES;
+	const u32 EventBus::DEFAULT_CAPACITY;
+	std::atomic<u32> EventBus::sTypeCount(0);
+
+	EventBus::EventBus() : ISystem()
+		, mNextID(0)
+	{
+		for (u32 i = 0; i < MAX_EVENT_TYPES; ++i)
+		{
+			mChannels[i] = NULL;
+			mCapacities[i] = 0;
+		}
+	}
+
+	EventBus::~EventBus()
+	{
+		Shutdown();
+	}
+
+	bool EventBus::Initialize()
+	{
+		return true;
+	}
+
+	void EventBus::Shutdown()
+	{
+		for (u32 i = 0; i < MAX_EVENT_TYPES; ++i)
+		{
+			delete mChannels[i].load();
+			mChannels[i] = NULL;
+		}
+	}
+
+	void EventBus::Unsubscribe(u32 id)
+	{
+		for (u32 i = 0; i < MAX_EVENT_TYPES; ++i)
+		{
+			IEventChannel * channel = mChannels[i].load();
+			if (channel && channel->Unsubscribe(id))
+				return;
+		}
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		Dispatch
+	// \brief	Every channel, in type index order (the order the types were
+	//			first used, stable from frame to frame). All the batches are
+	//			collected first: what a subscriber publishes, even of a type
+	//			delivered later in the loop, waits for the next dispatch.
+	// ----------------------------------------------------------------------------
+	void EventBus::Dispatch()
+	{
+		u32 count = (std::min)(sTypeCount.load(), MAX_EVENT_TYPES);
+		for (u32 i = 0; i < count; ++i)
+		{
+			IEventChannel * channel = mChannels[i].load(std::memory_order_acquire);
+			if (channel)
+				channel->Collect();
+		}
+		for (u32 i = 0; i < count; ++i)
+		{
+			IEventChannel * channel = mChannels[i].load(std::memory_order_acquire);
+			if (channel)
+				channel->Deliver();
+		}
+	}
+}
@@ -0,0 +1,381 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXEventBus.h
+// Purpose:	Typed events between the systems. Any thread publishes into the
+//			ring buffer of the event type (lock-free, multiple producers and
+//			one consumer), the events are handed to the subscribers in
+//			batches when the bus is dispatched, at fixed points of the frame.
+// ----------------------------------------------------------------------------
+#ifndef AEX_EVENT_BUS_H_
+#define AEX_EVENT_BUS_H_
+
+#include "AEXJobSystem.h"		// SpinLock
+#include <type_traits>
+#include <algorithm>
+#include <cassert>
+
+namespace AEX
+{
+	// ----------------------------------------------------------------------------
+	// \class	EventRing
+	// \brief	Bounded MPSC queue (each cell has a sequence number, the
+	//			producers claim a cell with a CAS on the write index). Push
+	//			fails when it is full. T is copied, it has to be POD (no
+	//			memory of its own).
+	template <typename T>
+	class EventRing
+	{
+	public:
+		explicit EventRing(u32 capacity);		// rounded up to a power of 2
+		~EventRing() { delete[] mCells; }
+
+		bool Push(const T & ev);				// any thread
+		bool Pop(T & ev);						// the consumer only
+		u32  GetCapacity() const { return mMask + 1; }
+
+	private:
+		EventRing(const EventRing &);
+		EventRing & operator=(const EventRing &);
+
+		struct Cell
+		{
+			std::atomic<u32>	mSequence;
+			T					mEvent;
+		};
+
+		Cell *				mCells;
+		u32					mMask;
+		std::atomic<u32>	mWrite;
+		u32					mRead;
+	};
+
+	// ----------------------------------------------------------------------------
+	// \class	IEventChannel
+	// \brief	Queue and subscribers of one event type.
+	class IEventChannel
+	{
+	public:
+		virtual ~IEventChannel() {}
+		virtual void Collect() = 0;				// the queued events to the batch
+		virtual void Deliver() = 0;				// the batch to the subscribers
+		void Dispatch() { Collect(); Deliver(); }
+		virtual bool Unsubscribe(u32 id) = 0;
+		virtual void Clear() = 0;				// drops the queued events
+
+		u64 GetPublished() const { return mPublished.load(); }
+		u64 GetDropped() const { return mDropped.load(); }
+		u32 GetSubscriberCount() const { return mSubscriberCount.load(); }
+
+	protected:
+		IEventChannel() : mPublished(0), mDropped(0), mSubscriberCount(0) {}
+		std::atomic<u64>	mPublished;
+		std::atomic<u64>	mDropped;			// the ring was full
+		std::atomic<u32>	mSubscriberCount;	// read by the publishers, see EventBus::HasSubscribers
+	};
+
+	// fn(events, count), the batch of one dispatch in publish order (per thread)
+	template <typename T>
+	using EventFn = std::function<void(const T *, u32)>;
+
+	template <typename T>
+	class EventChannel : public IEventChannel
+	{
+	public:
+		explicit EventChannel(u32 capacity) : mRing(capacity), mbDispatching(false) { mBatch.reserve(mRing.GetCapacity()); }
+
+		bool Publish(const T & ev);
+		void Subscribe(u32 id, const EventFn<T> & fn, s32 priority);
+		virtual bool Unsubscribe(u32 id);
+		virtual void Collect();
+		virtual void Deliver();
+		virtual void Clear();
+		u32 GetCapacity() const { return mRing.GetCapacity(); }
+
+	private:
+		struct Subscriber
+		{
+			u32			mID;					// 0 once unsubscribed during a dispatch
+			s32			mPriority;
+			EventFn<T>	mFn;
+		};
+		void Insert(const Subscriber & sub);
+
+		EventRing<T>			mRing;
+		std::vector<T>			mBatch;			// collected, not delivered yet
+		std::vector<Subscriber>	mSubscribers;	// by priority, then subscription order
+		std::vector<Subscriber>	mAdded;			// during a dispatch, inserted after it
+		bool					mbDispatching;
+	};
+
+	// ----------------------------------------------------------------------------
+	// \class	EventBus
+	// \brief	One channel per event type, created the first time the type is
+	//			used (from any thread). Subscriptions and Dispatch are for the
+	//			main thread. Dispatch collects the queued events of every type
+	//			before calling anybody, so the events published while
+	//			dispatching (from a subscriber), of any type, wait for the next
+	//			dispatch.
+	class EventBus : public ISystem
+	{
+		AEX_RTTI_DECL(EventBus, ISystem);
+		AEX_SINGLETON(EventBus);
+
+	public:
+		static const u32 MAX_EVENT_TYPES = 64;
+		static const u32 DEFAULT_CAPACITY = 1024;
+
+		virtual ~EventBus();
+
+		// ------------------------------------------------------------------------
+		// System Functions
+		virtual bool Initialize();
+		void Shutdown();						// deletes the channels and the subscriptions
+
+		// Capacity of the ring of T, before it is first used (0 = DEFAULT_CAPACITY)
+		template <typename T> void SetCapacity(u32 capacity);
+
+		// Any thread. False when the ring of T is full (the event is dropped).
+		template <typename T> bool Publish(const T & ev) { return GetChannel<T>()->Publish(ev); }
+
+		// Any thread. For the publishers that can skip building the events
+		// nobody listens to (nothing drains their ring then).
+		template <typename T> bool HasSubscribers() { return GetChannel<T>()->GetSubscriberCount() != 0; }
+
+		// Lower priorities run first. Returns the id for Unsubscribe.
+		template <typename T> u32 Subscribe(const EventFn<T> & fn, s32 priority = 0);
+		void Unsubscribe(u32 id);
+
+		// Hands the events queued when it starts to the subscribers, type by
+		// type (in the order the types were first used) or only T.
+		void Dispatch();
+		template <typename T> void Dispatch() { GetChannel<T>()->Dispatch(); }
+
+		// Stats
+		template <typename T> u64 GetPublished() { return GetChannel<T>()->GetPublished(); }
+		template <typename T> u64 GetDropped() { return GetChannel<T>()->GetDropped(); }
+
+	private:
+		template <typename T> static u32 TypeIndex();
+		template <typename T> EventChannel<T> * GetChannel();
+
+		static std::atomic<u32>			sTypeCount;
+		std::atomic<IEventChannel*>		mChannels[MAX_EVENT_TYPES];
+		u32								mCapacities[MAX_EVENT_TYPES];
+		SpinLock						mCreateLock;
+		u32								mNextID;
+	};
+}
+
+// Easy access to singleton
+#define aexEvents (AEX::EventBus::Instance())
+// ---------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Template implementation
+namespace AEX
+{
+	// ----------------------------------------------------------------------------
+	// EventRing
+	template <typename T>
+	EventRing<T>::EventRing(u32 capacity) : mWrite(0), mRead(0)
+	{
+		u32 size = 2;
+		while (size < capacity)
+			size <<= 1;
+		mCells = new Cell[size];
+		mMask = size - 1;
+		for (u32 i = 0; i < size; ++i)
+			mCells[i].mSequence.store(i, std::memory_order_relaxed);
+	}
+
+	template <typename T>
+	bool EventRing<T>::Push(const T & ev)
+	{
+		u32 pos = mWrite.load(std::memory_order_relaxed);
+		Cell * cell;
+		for (;;)
+		{
+			cell = &mCells[pos & mMask];
+			s32 diff = static_cast<s32>(cell->mSequence.load(std::memory_order_acquire) - pos);
+			if (diff == 0)
+			{
+				// the cell is free for pos, claim it
+				if (mWrite.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+				return false;		// not read yet, full
+			else
+				pos = mWrite.load(std::memory_order_relaxed);
+		}
+		cell->mEvent = ev;
+		cell->mSequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	template <typename T>
+	bool EventRing<T>::Pop(T & ev)
+	{
+		Cell * cell = &mCells[mRead & mMask];
+		if (static_cast<s32>(cell->mSequence.load(std::memory_order_acquire) - (mRead + 1)) < 0)
+			return false;			// empty, or claimed but not written yet
+		ev = cell->mEvent;
+		cell->mSequence.store(mRead + mMask + 1, std::memory_order_release);
+		mRead++;
+		return true;
+	}
+
+	// ----------------------------------------------------------------------------
+	// EventChannel
+	template <typename T>
+	bool EventChannel<T>::Publish(const T & ev)
+	{
+		if (!mRing.Push(ev))
+		{
+			mDropped++;
+			return false;
+		}
+		mPublished++;
+		return true;
+	}
+
+	template <typename T>
+	void EventChannel<T>::Insert(const Subscriber & sub)
+	{
+		auto it = std::upper_bound(mSubscribers.begin(), mSubscribers.end(), sub,
+			[](const Subscriber & a, const Subscriber & b) { return a.mPriority < b.mPriority; });
+		mSubscribers.insert(it, sub);
+	}
+
+	template <typename T>
+	void EventChannel<T>::Subscribe(u32 id, const EventFn<T> & fn, s32 priority)
+	{
+		Subscriber sub = { id, priority, fn };
+		mSubscriberCount++;
+		if (mbDispatching)
+			mAdded.push_back(sub);
+		else
+			Insert(sub);
+	}
+
+	template <typename T>
+	bool EventChannel<T>::Unsubscribe(u32 id)
+	{
+		for (auto it = mAdded.begin(); it != mAdded.end(); ++it)
+		{
+			if (it->mID == id)
+			{
+				mAdded.erase(it);
+				mSubscriberCount--;
+				return true;
+			}
+		}
+		for (auto it = mSubscribers.begin(); it != mSubscribers.end(); ++it)
+		{
+			if (it->mID == id)
+			{
+				mSubscriberCount--;
+				if (mbDispatching)
+					it->mID = 0;		// removed after the dispatch
+				else
+					mSubscribers.erase(it);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Only what is queued now, the events published after it (by the
+	// subscribers) go to the next dispatch. Adds to what wasn't delivered.
+	template <typename T>
+	void EventChannel<T>::Collect()
+	{
+		if (mbDispatching)
+			return;
+
+		T ev;
+		while (mBatch.size() < mBatch.capacity() && mRing.Pop(ev))
+			mBatch.push_back(ev);
+	}
+
+	template <typename T>
+	void EventChannel<T>::Deliver()
+	{
+		if (mbDispatching || mBatch.empty())
+			return;
+
+		mbDispatching = true;
+		for (u32 i = 0; i < mSubscribers.size(); ++i)
+		{
+			if (mSubscribers[i].mID)
+				mSubscribers[i].mFn(&mBatch[0], mBatch.size());
+		}
+		mbDispatching = false;
+		mBatch.clear();
+
+		mSubscribers.erase(std::remove_if(mSubscribers.begin(), mSubscribers.end(),
+			[](const Subscriber & sub) { return sub.mID == 0; }), mSubscribers.end());
+		FOR_EACH(it, mAdded)
+			Insert(*it);
+		mAdded.clear();
+	}
+
+	template <typename T>
+	void EventChannel<T>::Clear()
+	{
+		if (!mbDispatching)
+			mBatch.clear();
+		T ev;
+		while (mRing.Pop(ev))
+			;
+	}
+
+	// ----------------------------------------------------------------------------
+	// EventBus
+	template <typename T>
+	u32 EventBus::TypeIndex()
+	{
+		static const u32 index = sTypeCount++;
+		return index;
+	}
+
+	template <typename T>
+	EventChannel<T> * EventBus::GetChannel()
+	{
+		// AEVec2 has a copy constructor, so trivially copyable is too strict.
+		// What matters is that an event doesn't own memory.
+		static_assert(std::is_trivially_destructible<T>::value, "events are copied into a ring buffer, they have to be POD");
+
+		u32 index = TypeIndex<T>();
+		assert(index < MAX_EVENT_TYPES);
+		IEventChannel * channel = mChannels[index].load(std::memory_order_acquire);
+		if (!channel)
+		{
+			mCreateLock.lock();
+			channel = mChannels[index].load(std::memory_order_relaxed);
+			if (!channel)
+			{
+				channel = new EventChannel<T>(mCapacities[index] ? mCapacities[index] : DEFAULT_CAPACITY);
+				mChannels[index].store(channel, std::memory_order_release);
+			}
+			mCreateLock.unlock();
+		}
+		return static_cast<EventChannel<T>*>(channel);
+	}
+
+	template <typename T>
+	void EventBus::SetCapacity(u32 capacity)
+	{
+		mCapacities[TypeIndex<T>()] = capacity;
+	}
+
+	template <typename T>
+	u32 EventBus::Subscribe(const EventFn<T> & fn, s32 priority)
+	{
+		u32 id = ++mNextID;
+		GetChannel<T>()->Subscribe(id, fn, priority);
+		return id;
+	}
+}
+
+#endif
@@ -0,0 +1,133 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXFrameMemory.cpp
+// Purpose:	Implementation of the frame arenas.
+// ----------------------------------------------------------------------------
+#include "AEXFrameMemory.h"
+#include "AEXJobSystem.h"
+#include <cstdint>	// uintptr_t
+#include <cstring>	// memset
+
+namespace AEX
+{
+	const u8 FrameArena::POISON;
+	const u32 FrameMemory::DEFAULT_ARENA_SIZE;
+
+	// ----------------------------------------------------------------------------
+	#pragma region// FRAME ARENA
+
+	void FrameArena::Initialize(u32 capacity)
+	{
+		Release();
+		mBlock.resize(capacity);
+		mPeak = 0;
+	}
+
+	void FrameArena::Release()
+	{
+		Reset();
+		std::vector<u8>().swap(mBlock);
+	}
+
+	void * FrameArena::Allocate(u32 size, u32 alignment)
+	{
+		if (size == 0)
+			size = 1;
+		mUsed += size + alignment - 1;
+		mPeak = mUsed > mPeak ? mUsed : mPeak;
+
+		if (!mBlock.empty())
+		{
+			// align the address, not the offset
+			uintptr_t base = reinterpret_cast<uintptr_t>(&mBlock[0]);
+			uintptr_t start = (base + mTop + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+			u32 top = static_cast<u32>(start - base) + size;
+			if (top <= mBlock.size())
+			{
+				mTop = top;
+				return reinterpret_cast<void*>(start);
+			}
+		}
+
+		// full, an extra block for this allocation only
+		u8 * block = new u8[size + alignment - 1];
+		mOverflow.push_back(block);
+		uintptr_t start = (reinterpret_cast<uintptr_t>(block) + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+		return reinterpret_cast<void*>(start);
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		Reset
+	// \brief	Frees everything. If the frame didn't fit the block grows to
+	//			the peak, so the extra blocks only happen while warming up.
+	// ----------------------------------------------------------------------------
+	void FrameArena::Reset()
+	{
+		if (!mOverflow.empty())
+		{
+			FOR_EACH(it, mOverflow)
+				delete[] *it;
+			mOverflow.clear();
+			mBlock.clear();
+			mBlock.resize(mPeak);
+			mTop = 0;
+		}
+
+	#if AEX_FRAME_MEMORY_POISON
+		if (mTop)
+			memset(&mBlock[0], POISON, mTop);
+	#endif
+		mTop = 0;
+		mUsed = 0;
+	}
+
+	#pragma endregion
+
+	// ----------------------------------------------------------------------------
+	#pragma region// FRAME MEMORY
+
+	FrameMemory::FrameMemory() : ISystem()
+		, mArenaSize(DEFAULT_ARENA_SIZE)
+	{}
+
+	FrameMemory::~FrameMemory()
+	{
+		Shutdown();
+	}
+
+	bool FrameMemory::Initialize()
+	{
+		Shutdown();
+
+		u32 count = aexJobs->GetThreadCount();
+		if (count == 0)
+			count = 1;
+		for (u32 i = 0; i < count; ++i)
+		{
+			FrameArena * arena = new FrameArena;
+			arena->Initialize(mArenaSize);
+			mArenas.push_back(arena);
+		}
+		return true;
+	}
+
+	void FrameMemory::Shutdown()
+	{
+		FOR_EACH(it, mArenas)
+			delete *it;
+		mArenas.clear();
+	}
+
+	void FrameMemory::StartFrame()
+	{
+		FOR_EACH(it, mArenas)
+			(*it)->Reset();
+	}
+
+	FrameArena * FrameMemory::GetArena()
+	{
+		return GetArena(aexJobs->GetWorkerIndex());
+	}
+
+	#pragma endregion
+}
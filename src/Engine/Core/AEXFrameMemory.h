@@ -0,0 +1,150 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXFrameMemory.h
+// Purpose:	Memory for the transient data of one frame: a bump allocator per
+//			JobSystem worker, everything is freed at once when the frame
+//			starts. FrameAllocator/FrameVector use it from the STL.
+// ----------------------------------------------------------------------------
+#ifndef AEX_FRAME_MEMORY_H_
+#define AEX_FRAME_MEMORY_H_
+
+#include "AEXSystem.h"
+#include <new>
+
+// Fills the freed frame memory with a pattern, a read of stale data is easy
+// to spot in the debugger (0xDD...)
+#ifndef AEX_FRAME_MEMORY_POISON
+#ifdef _DEBUG
+#define AEX_FRAME_MEMORY_POISON 1
+#else
+#define AEX_FRAME_MEMORY_POISON 0
+#endif
+#endif
+
+namespace AEX
+{
+	// ----------------------------------------------------------------------------
+	// \class	FrameArena
+	// \brief	Bump allocator. When the block is full the allocations go to
+	//			extra blocks, the next Reset replaces them by one block big
+	//			enough for the whole frame. Deallocation is a no-op, the memory
+	//			is only freed by Reset.
+	class FrameArena
+	{
+	public:
+		static const u8 POISON = 0xDD;
+
+		FrameArena() : mTop(0), mUsed(0), mPeak(0) {}
+		~FrameArena() { Release(); }
+
+		void Initialize(u32 capacity);
+		void Release();
+		void * Allocate(u32 size, u32 alignment = 16);
+		void Reset();
+
+		u32 GetUsed() const { return mUsed; }		// this frame, including the extra blocks
+		u32 GetPeak() const { return mPeak; }
+		u32 GetCapacity() const { return mBlock.size(); }
+
+	private:
+		FrameArena(const FrameArena &);
+		FrameArena & operator=(const FrameArena &);
+
+		std::vector<u8>		mBlock;
+		u32					mTop;
+		std::vector<u8*>	mOverflow;				// this frame only
+		u32					mUsed;
+		u32					mPeak;
+	};
+
+	// ----------------------------------------------------------------------------
+	// \class	FrameMemory
+	// \brief	One FrameArena per JobSystem worker (worker 0 is the main
+	//			thread), reset by the engine at the start of the frame, when no
+	//			job is running. It is also the scratch memory of the jobs, a
+	//			job allocates from the arena of the worker that runs it. The
+	//			threads that aren't workers (render thread) don't have one.
+	class FrameMemory : public ISystem
+	{
+		AEX_RTTI_DECL(FrameMemory, ISystem);
+		AEX_SINGLETON(FrameMemory);
+
+	public:
+		static const u32 DEFAULT_ARENA_SIZE = 256 * 1024;
+
+		virtual ~FrameMemory();
+
+		// ------------------------------------------------------------------------
+		// System Functions
+		virtual bool Initialize();				// one arena per aexJobs thread
+		void Shutdown();
+
+		void StartFrame();						// frees the last frame, main thread only
+
+		// arena of the calling thread, NULL if it isn't a worker
+		FrameArena * GetArena();
+		FrameArena * GetArena(u32 worker) { return worker < mArenas.size() ? mArenas[worker] : NULL; }
+		u32 GetArenaCount() const { return mArenas.size(); }
+		void SetArenaSize(u32 size) { mArenaSize = size; }	// applied on the next Initialize
+
+	private:
+		std::vector<FrameArena*>	mArenas;
+		u32							mArenaSize;
+	};
+
+	// ----------------------------------------------------------------------------
+	// \class	FrameAllocator
+	// \brief	STL allocator on the arena of the thread that creates it (or
+	//			the heap on a thread without one). The container must not
+	//			outlive the frame.
+	template <typename T>
+	class FrameAllocator
+	{
+	public:
+		typedef T value_type;
+		template <typename U> struct rebind { typedef FrameAllocator<U> other; };
+
+		FrameAllocator();
+		explicit FrameAllocator(FrameArena * arena) : mArena(arena) {}
+		template <typename U>
+		FrameAllocator(const FrameAllocator<U> & other) : mArena(other.GetArena()) {}
+
+		T * allocate(std::size_t count)
+		{
+			if (!mArena)
+				return static_cast<T*>(::operator new(count * sizeof(T)));
+			return static_cast<T*>(mArena->Allocate(static_cast<u32>(count * sizeof(T)), alignof(T)));
+		}
+		void deallocate(T * p, std::size_t)
+		{
+			if (!mArena)
+				::operator delete(p);
+		}
+
+		FrameArena * GetArena() const { return mArena; }
+
+	private:
+		FrameArena * mArena;
+	};
+
+	template <typename T, typename U>
+	bool operator==(const FrameAllocator<T> & a, const FrameAllocator<U> & b) { return a.GetArena() == b.GetArena(); }
+	template <typename T, typename U>
+	bool operator!=(const FrameAllocator<T> & a, const FrameAllocator<U> & b) { return a.GetArena() != b.GetArena(); }
+
+	template <typename T>
+	using FrameVector = std::vector<T, FrameAllocator<T> >;
+}
+
+// Easy access to singleton
+#define aexFrameMem (AEX::FrameMemory::Instance())
+// ---------------------------------------------------------------------------
+
+namespace AEX
+{
+	template <typename T>
+	FrameAllocator<T>::FrameAllocator() : mArena(aexFrameMem->GetArena())
+	{}
+}
+
+#endif
@@ -0,0 +1,337 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXJobSystem.cpp
+// Purpose:	Implementation of the job system.
+// ----------------------------------------------------------------------------
+#include "AEXJobSystem.h"
+
+namespace AEX
+{
+	const u32 JobSystem::INVALID_WORKER;
+
+	// index of the calling thread in JobSystem::mWorkers
+	static thread_local u32 tWorkerIndex = JobSystem::INVALID_WORKER;
+
+	// ----------------------------------------------------------------------------
+	#pragma region// JOB SYSTEM
+
+	JobSystem::JobSystem() : ISystem()
+		, mWorkerCount(0)
+		, mNextQueue(0)
+		, mQueuedJobs(0)
+		, mSleepers(0)
+		, mbQuit(false)
+		, mJobsRun(0)
+		, mSteals(0)
+	{}
+
+	JobSystem::~JobSystem()
+	{
+		Shutdown();
+	}
+
+	bool JobSystem::Initialize()
+	{
+		return Initialize(0);
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		Initialize
+	// \brief	Creates the deques and spawns threadCount - 1 threads,
+	//			the calling thread becomes worker 0.
+	// ----------------------------------------------------------------------------
+	bool JobSystem::Initialize(u32 threadCount)
+	{
+		Shutdown();
+
+		if (threadCount == 0)
+			threadCount = std::thread::hardware_concurrency();
+		if (threadCount == 0)
+			threadCount = 1;
+
+		mbQuit = false;
+		mQueuedJobs = 0;
+		for (u32 i = 0; i < threadCount; ++i)
+			mWorkers.push_back(new Worker);
+		mWorkerCount = threadCount;
+
+		tWorkerIndex = 0;
+		for (u32 i = 1; i < mWorkerCount; ++i)
+			mWorkers[i]->mThread = std::thread(&JobSystem::WorkerLoop, this, i);
+		return true;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		Shutdown
+	// \brief	Runs what is still queued, then wakes up and joins the workers.
+	// ----------------------------------------------------------------------------
+	void JobSystem::Shutdown()
+	{
+		if (!mWorkerCount)
+			return;
+
+		if (GetWorkerIndex() != INVALID_WORKER)
+		{
+			while (RunOne(GetWorkerIndex()))
+				;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mSleepMutex);
+			mbQuit = true;
+		}
+		mWakeCV.notify_all();
+
+		for (u32 i = 1; i < mWorkerCount; ++i)
+			mWorkers[i]->mThread.join();
+		FOR_EACH(it, mWorkers)
+			delete *it;
+		mWorkers.clear();
+		mWorkerCount = 0;
+		tWorkerIndex = INVALID_WORKER;
+	}
+
+	u32 JobSystem::GetWorkerIndex() const
+	{
+		return tWorkerIndex < mWorkerCount ? tWorkerIndex : INVALID_WORKER;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		Run
+	// \brief	Queues the job. Without workers (not initialized) it runs now.
+	// ----------------------------------------------------------------------------
+	void JobSystem::Run(const JobFn & fn, JobCounter * counter)
+	{
+		if (!mWorkerCount)
+		{
+			fn(0);
+			return;
+		}
+
+		if (counter)
+			counter->mPending++;
+		Job job = { fn, counter };
+		Push(job);
+	}
+
+	void JobSystem::RunAfter(JobCounter & dependency, const JobFn & fn, JobCounter * counter)
+	{
+		if (counter)
+			counter->mPending++;
+		Job job = { fn, counter };
+
+		// Finish takes the continuations and decrements under the lock
+		dependency.mLock.lock();
+		if (dependency.mPending.load() != 0)
+		{
+			dependency.mContinuations.push_back(job);
+			dependency.mLock.unlock();
+			return;
+		}
+		dependency.mLock.unlock();
+
+		if (!mWorkerCount)
+		{
+			fn(0);
+			Finish(0, counter);
+			return;
+		}
+		Push(job);
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		Wait
+	// \brief	Helps with the queued jobs (any of them) until counter is done.
+	// ----------------------------------------------------------------------------
+	void JobSystem::Wait(JobCounter & counter)
+	{
+		u32 worker = GetWorkerIndex();
+		while (!counter.IsDone())
+		{
+			if (worker == INVALID_WORKER || !RunOne(worker))
+				std::this_thread::yield();
+		}
+
+		// the thread that finished the last job may still be releasing the
+		// continuations, don't let the caller destroy the counter under it
+		counter.mLock.lock();
+		counter.mLock.unlock();
+	}
+
+	bool JobSystem::RunPendingJob()
+	{
+		u32 worker = GetWorkerIndex();
+		return worker != INVALID_WORKER && RunOne(worker);
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		ParallelFor
+	// \brief	The calling worker splits the range (see SplitRange) and waits.
+	// ----------------------------------------------------------------------------
+	void JobSystem::ParallelFor(u32 count, u32 grain, const RangeFn & fn)
+	{
+		if (count == 0)
+			return;
+		if (grain == 0)
+			grain = 1;
+
+		u32 worker = GetWorkerIndex();
+		if (mWorkerCount <= 1 || count <= grain)
+		{
+			fn(worker == INVALID_WORKER ? 0 : worker, 0, count);
+			return;
+		}
+
+		JobCounter counter;
+		if (worker == INVALID_WORKER)
+		{
+			// the worker indices of fn have to be valid, let a worker do it
+			Run([this, &fn, count, grain, &counter](u32 w)
+			{
+				SplitRange(w, &fn, 0, count, grain, &counter);
+			}, &counter);
+		}
+		else
+			SplitRange(worker, &fn, 0, count, grain, &counter);
+		Wait(counter);
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		SplitRange
+	// \brief	Queues the upper half of the range as a new job until the rest
+	//			fits in grain, then runs it. The stolen halves split again on
+	//			the thief, so the work spreads in log(chunks) steps.
+	// ----------------------------------------------------------------------------
+	void JobSystem::SplitRange(u32 worker, const RangeFn * fn, u32 begin, u32 end, u32 grain, JobCounter * counter)
+	{
+		while (end - begin > grain)
+		{
+			u32 chunks = (end - begin + grain - 1) / grain;
+			u32 mid = begin + (chunks / 2) * grain;
+			Run([this, fn, mid, end, grain, counter](u32 w)
+			{
+				SplitRange(w, fn, mid, end, grain, counter);
+			}, counter);
+			end = mid;
+		}
+		(*fn)(worker, begin, end);
+	}
+
+	void JobSystem::Push(const Job & job)
+	{
+		u32 worker = GetWorkerIndex();
+		if (worker == INVALID_WORKER)
+			worker = mNextQueue++ % mWorkerCount;
+
+		Worker * queue = mWorkers[worker];
+		queue->mLock.lock();
+		queue->mJobs.push_back(job);
+		queue->mLock.unlock();
+
+		// mQueuedJobs is incremented before mSleepers is read, a worker going
+		// to sleep increments mSleepers before reading mQueuedJobs. One of
+		// them sees the other.
+		mQueuedJobs++;
+		if (mSleepers.load())
+		{
+			std::lock_guard<std::mutex> lock(mSleepMutex);
+			mWakeCV.notify_one();
+		}
+	}
+
+	bool JobSystem::Pop(u32 worker, Job & job)
+	{
+		Worker * queue = mWorkers[worker];
+		queue->mLock.lock();
+		if (queue->mJobs.empty())
+		{
+			queue->mLock.unlock();
+			return false;
+		}
+		job = std::move(queue->mJobs.back());
+		queue->mJobs.pop_back();
+		queue->mLock.unlock();
+		mQueuedJobs--;
+		return true;
+	}
+
+	bool JobSystem::Steal(u32 worker, Job & job)
+	{
+		for (u32 i = 1; i < mWorkerCount; ++i)
+		{
+			Worker * victim = mWorkers[(worker + i) % mWorkerCount];
+			victim->mLock.lock();
+			if (victim->mJobs.empty())
+			{
+				victim->mLock.unlock();
+				continue;
+			}
+			job = std::move(victim->mJobs.front());
+			victim->mJobs.pop_front();
+			victim->mLock.unlock();
+			mQueuedJobs--;
+			mSteals++;
+			return true;
+		}
+		return false;
+	}
+
+	bool JobSystem::RunOne(u32 worker)
+	{
+		Job job;
+		if (!Pop(worker, job) && !Steal(worker, job))
+			return false;
+
+		job.mFn(worker);
+		mJobsRun++;
+		Finish(worker, job.mCounter);
+		return true;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		Finish
+	// \brief	Decrements the counter, the last job queues the continuations.
+	// ----------------------------------------------------------------------------
+	void JobSystem::Finish(u32 worker, JobCounter * counter)
+	{
+		if (!counter)
+			return;
+
+		std::vector<Job> continuations;
+		counter->mLock.lock();
+		if (--counter->mPending == 0)
+			continuations.swap(counter->mContinuations);
+		counter->mLock.unlock();
+
+		FOR_EACH(it, continuations)
+		{
+			if (mWorkerCount)
+				Push(*it);
+			else
+			{
+				it->mFn(worker);
+				Finish(worker, it->mCounter);
+			}
+		}
+	}
+
+	void JobSystem::WorkerLoop(u32 worker)
+	{
+		tWorkerIndex = worker;
+		for (;;)
+		{
+			if (RunOne(worker))
+				continue;
+
+			// nothing to run or steal
+			std::unique_lock<std::mutex> lock(mSleepMutex);
+			if (mbQuit)
+				return;
+			mSleepers++;
+			mWakeCV.wait(lock, [this]() { return mbQuit || mQueuedJobs.load() != 0; });
+			mSleepers--;
+		}
+	}
+
+	#pragma endregion
+}
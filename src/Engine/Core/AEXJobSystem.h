@@ -0,0 +1,167 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXJobSystem.h
+// Purpose:	Engine wide job system: a fixed pool of worker threads, each with
+//			its own job deque (the owner works LIFO at the back, the idle
+//			workers steal FIFO from the front), job counters with
+//			continuations for the dependencies. The per worker memory for the
+//			temporaries of the jobs is aexFrameMem's (AEXFrameMemory.h).
+// ----------------------------------------------------------------------------
+#ifndef AEX_JOB_SYSTEM_H_
+#define AEX_JOB_SYSTEM_H_
+
+#include "AEXSystem.h"
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace AEX
+{
+	class JobCounter;
+
+	// fn(worker), worker is the index of the thread that runs the job
+	typedef std::function<void(u32)> JobFn;
+	// fn(worker, begin, end) processes the elements [begin, end)
+	typedef std::function<void(u32, u32, u32)> RangeFn;
+
+	// ----------------------------------------------------------------------------
+	// \class	SpinLock
+	// \brief	For the short critical sections of the job deques and counters.
+	class SpinLock
+	{
+	public:
+		SpinLock() { mFlag.clear(); }
+		void lock()
+		{
+			while (mFlag.test_and_set(std::memory_order_acquire))
+				std::this_thread::yield();
+		}
+		void unlock() { mFlag.clear(std::memory_order_release); }
+
+	private:
+		SpinLock(const SpinLock &);
+		SpinLock & operator=(const SpinLock &);
+		std::atomic_flag mFlag;
+	};
+
+	// ----------------------------------------------------------------------------
+	// \struct	Job
+	struct Job
+	{
+		JobFn			mFn;
+		JobCounter *	mCounter;	// decremented when mFn returns (can be NULL)
+	};
+
+	// ----------------------------------------------------------------------------
+	// \class	JobCounter
+	// \brief	Number of unfinished jobs of a group. When it reaches zero its
+	//			continuations (JobSystem::RunAfter) are queued. Reusable once
+	//			done. Wait on it before it goes out of scope.
+	class JobCounter
+	{
+	public:
+		JobCounter() : mPending(0) {}
+		bool IsDone() const { return mPending.load() == 0; }
+
+	private:
+		friend class JobSystem;
+		JobCounter(const JobCounter &);
+		JobCounter & operator=(const JobCounter &);
+
+		std::atomic<u32>	mPending;
+		SpinLock			mLock;			// mContinuations and the last decrement
+		std::vector<Job>	mContinuations;
+	};
+
+	// ----------------------------------------------------------------------------
+	// \class	JobSystem
+	// \brief	The thread that calls Initialize (the main thread) is worker 0
+	//			and only runs jobs while it waits, the other workers sleep when
+	//			there is nothing to run or steal. Waiting never blocks a worker:
+	//			it runs the pending jobs until the counter is done, so the jobs
+	//			can start and wait for other jobs.
+	class JobSystem : public ISystem
+	{
+		AEX_RTTI_DECL(JobSystem, ISystem);
+		AEX_SINGLETON(JobSystem);
+
+	public:
+		static const u32 INVALID_WORKER = 0xFFFFFFFF;
+
+		virtual ~JobSystem();
+
+		// ------------------------------------------------------------------------
+		// System Functions
+		virtual bool Initialize();				// hardware concurrency
+		bool Initialize(u32 threadCount);		// includes the calling thread, 0 = hardware concurrency
+		void Shutdown();						// runs the queued jobs and joins the threads
+		bool IsRunning() const { return mWorkerCount != 0; }
+
+		u32 GetThreadCount() const { return mWorkerCount; }
+		u32 GetWorkerIndex() const;				// of the calling thread, INVALID_WORKER if it isn't one
+
+		// ------------------------------------------------------------------------
+		// Jobs. The counter is incremented now and decremented when the job is
+		// done. Can be called from any thread.
+		void Run(const JobFn & fn, JobCounter * counter = NULL);
+
+		// Queues fn when dependency is done (now if it already is).
+		void RunAfter(JobCounter & dependency, const JobFn & fn, JobCounter * counter = NULL);
+
+		// Runs jobs until the counter is done (a thread that isn't a worker
+		// only yields).
+		void Wait(JobCounter & counter);
+
+		// Runs one queued job on the calling worker, for threads that wait on
+		// something else than a counter. False if there was none.
+		bool RunPendingJob();
+
+		// Splits [0, count) in halves until the ranges are at most grain
+		// elements (the ranges always start at a multiple of grain), the idle
+		// workers steal the biggest halves. Blocks until all are done.
+		void ParallelFor(u32 count, u32 grain, const RangeFn & fn);
+
+		// Stats
+		u64 GetJobsRun() const { return mJobsRun.load(); }
+		u64 GetSteals() const { return mSteals.load(); }
+
+	private:
+		struct Worker
+		{
+			SpinLock		mLock;
+			std::deque<Job>	mJobs;
+			std::thread		mThread;
+		};
+
+		void Push(const Job & job);
+		bool Pop(u32 worker, Job & job);		// back of its own deque
+		bool Steal(u32 worker, Job & job);		// front of the other deques
+		bool RunOne(u32 worker);				// false if there was nothing to run
+		void Finish(u32 worker, JobCounter * counter);
+		void WorkerLoop(u32 worker);
+		void SplitRange(u32 worker, const RangeFn * fn, u32 begin, u32 end, u32 grain, JobCounter * counter);
+
+		std::vector<Worker*>		mWorkers;
+		u32							mWorkerCount;
+		std::atomic<u32>			mNextQueue;		// for the jobs queued by other threads
+
+		// sleeping
+		std::mutex					mSleepMutex;
+		std::condition_variable		mWakeCV;
+		std::atomic<u32>			mQueuedJobs;
+		std::atomic<u32>			mSleepers;
+		std::atomic<bool>			mbQuit;
+
+		std::atomic<u64>			mJobsRun;
+		std::atomic<u64>			mSteals;
+	};
+}
+
+// Easy access to singleton
+#define aexJobs (AEX::JobSystem::Instance())
+// ---------------------------------------------------------------------------
+
+#endif
@@ -19,14 +19,18 @@ namespace AEX
 		
 	public:
 		static std::map<std::string, Rtti> Types;
+		// registered once per type (GetType/TYPE are called a lot, the names
+		// would be built every time)
 		template<typename type> static const Rtti &  RttiAdd()
 		{
-			return RttiAdd(GetTypeName<type>().c_str(), "NULL");
+			static const Rtti & rtti = RttiAdd(GetTypeName<type>().c_str(), "NULL");
+			return rtti;
 		}
 
 		template<typename type, typename parent> static const Rtti &  RttiAdd()
 		{
-			return RttiAdd(GetTypeName<type>().c_str(), GetTypeName<parent>().c_str());
+			static const Rtti & rtti = RttiAdd(GetTypeName<type>().c_str(), GetTypeName<parent>().c_str());
+			return rtti;
 		}
 
 		static const Rtti & RttiAdd(const char * typeName, const char * parentName);
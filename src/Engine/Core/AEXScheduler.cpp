@@ -0,0 +1,232 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXScheduler.cpp
+// Purpose:	Implementation of the system scheduler.
+// ----------------------------------------------------------------------------
+#include "AEXScheduler.h"
+#include "..\Platform\AEXTime.h"
+
+namespace AEX
+{
+	SystemScheduler::SystemScheduler() : ISystem()
+		, mbGraphDirty(false)
+		, mbParallel(true)
+		, mNodesLeft(0)
+		, mFrameStart(0.0)
+		, mFrameTime(0.0)
+	{}
+
+	bool SystemScheduler::Initialize()
+	{
+		mbParallel = true;
+		mFrameTime = 0.0;
+		return true;
+	}
+
+	void SystemScheduler::Shutdown()
+	{
+		ClearSystems();
+	}
+
+	// ----------------------------------------------------------------------------
+	#pragma region// REGISTRATION
+
+	void SystemScheduler::AddSystem(ISystem * system)
+	{
+		FOR_EACH(it, mSystems)
+		{
+			if (*it == system)
+				return;
+		}
+		mSystems.push_back(system);
+		mbGraphDirty = true;
+	}
+
+	void SystemScheduler::RemoveSystem(ISystem * system)
+	{
+		FOR_EACH(it, mSystems)
+		{
+			if (*it == system)
+			{
+				mSystems.erase(it);
+				mbGraphDirty = true;
+				return;
+			}
+		}
+	}
+
+	void SystemScheduler::ClearSystems()
+	{
+		mSystems.clear();
+		mbGraphDirty = true;
+	}
+
+	void SystemScheduler::Rebuild()
+	{
+		mbGraphDirty = true;
+	}
+
+	const std::vector<u32> & SystemScheduler::GetSuccessors(u32 system)
+	{
+		if (mbGraphDirty)
+			BuildGraph();
+		return mSuccessors[system];
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		BuildGraph
+	// \brief	Edges only go from a system to a later one, so the registration
+	//			order is a valid order and there can't be cycles. The names
+	//			are cached here, Rtti::RttiAdd isn't thread safe.
+	// ----------------------------------------------------------------------------
+	void SystemScheduler::BuildGraph()
+	{
+		mbGraphDirty = false;
+
+		u32 count = mSystems.size();
+		mAccess.resize(count);
+		mNames.resize(count);
+		mSuccessors.assign(count, std::vector<u32>());
+		mPredecessorCount.assign(count, 0);
+		std::vector<std::atomic<u32> >(count).swap(mPending);
+		mTimeline.resize(count);
+
+		for (u32 i = 0; i < count; ++i)
+		{
+			mAccess[i].Clear();
+			mSystems[i]->DeclareAccess(mAccess[i]);
+			mNames[i] = mSystems[i]->GetType().GetName();
+		}
+
+		for (u32 i = 0; i < count; ++i)
+		{
+			for (u32 j = i + 1; j < count; ++j)
+			{
+				if (mAccess[i].ConflictsWith(mAccess[j]))
+				{
+					mSuccessors[i].push_back(j);
+					mPredecessorCount[j]++;
+				}
+			}
+		}
+	}
+
+	#pragma endregion
+
+	// ----------------------------------------------------------------------------
+	#pragma region// FRAME
+
+	//!----------------------------------------------------------------------------
+	// \fn		Update
+	// \brief	Queues the systems without predecessors and runs the MainThread
+	//			ones (or any other job) until every system is done.
+	// ----------------------------------------------------------------------------
+	void SystemScheduler::Update()
+	{
+		if (mbGraphDirty)
+			BuildGraph();
+
+		u32 count = mSystems.size();
+		mFrameStart = FRC::GetCPUTime();
+
+		u32 worker = aexJobs->GetWorkerIndex();
+		if (!mbParallel || worker == JobSystem::INVALID_WORKER || aexJobs->GetThreadCount() <= 1)
+		{
+			for (u32 i = 0; i < count; ++i)
+				RunNode(i, worker == JobSystem::INVALID_WORKER ? 0 : worker);
+			mFrameTime = FRC::GetCPUTime() - mFrameStart;
+			return;
+		}
+
+		mNodesLeft = count;
+		for (u32 i = 0; i < count; ++i)
+			mPending[i] = mPredecessorCount[i];
+		for (u32 i = 0; i < count; ++i)
+		{
+			if (mPredecessorCount[i] == 0)
+				Release(i);
+		}
+
+		while (mNodesLeft.load())
+		{
+			u32 node = 0;
+			bool mainReady = false;
+			mMainLock.lock();
+			if (!mMainReady.empty())
+			{
+				node = mMainReady.back();
+				mMainReady.pop_back();
+				mainReady = true;
+			}
+			mMainLock.unlock();
+
+			if (mainReady)
+			{
+				RunNode(node, worker);
+				Complete(node);
+			}
+			else if (!aexJobs->RunPendingJob())
+				std::this_thread::yield();
+		}
+		mFrameTime = FRC::GetCPUTime() - mFrameStart;
+	}
+
+	void SystemScheduler::Release(u32 node)
+	{
+		if (mAccess[node].mbMainThread)
+		{
+			mMainLock.lock();
+			mMainReady.push_back(node);
+			mMainLock.unlock();
+			return;
+		}
+		aexJobs->Run([this, node](u32 worker)
+		{
+			RunNode(node, worker);
+			Complete(node);
+		});
+	}
+
+	void SystemScheduler::RunNode(u32 node, u32 worker)
+	{
+		Timing & timing = mTimeline[node];
+		timing.mName = mNames[node];
+		timing.mWorker = worker;
+		timing.mStart = FRC::GetCPUTime() - mFrameStart;
+
+		mSystems[node]->Update();
+
+		timing.mEnd = FRC::GetCPUTime() - mFrameStart;
+	}
+
+	void SystemScheduler::Complete(u32 node)
+	{
+		FOR_EACH(it, mSuccessors[node])
+		{
+			if (--mPending[*it] == 0)
+				Release(*it);
+		}
+		mNodesLeft--;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		WriteTimeline
+	// \brief	Trace event format (load it in chrome://tracing), one row per
+	//			worker, times in microseconds.
+	// ----------------------------------------------------------------------------
+	void SystemScheduler::WriteTimeline(std::ostream & o) const
+	{
+		o << "{\"traceEvents\":[";
+		for (u32 i = 0; i < mTimeline.size(); ++i)
+		{
+			const Timing & timing = mTimeline[i];
+			o << (i ? "," : "") << "{\"name\":\"" << (timing.mName ? timing.mName : "") << "\",\"ph\":\"X\",\"pid\":0"
+				<< ",\"tid\":" << timing.mWorker
+				<< ",\"ts\":" << timing.mStart * 1000000.0
+				<< ",\"dur\":" << (timing.mEnd - timing.mStart) * 1000000.0 << "}";
+		}
+		o << "]}";
+	}
+
+	#pragma endregion
+}
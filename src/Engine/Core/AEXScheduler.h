@@ -0,0 +1,94 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXScheduler.h
+// Purpose:	Runs the Update of the registered systems once per frame on the
+//			JobSystem. The order comes from the component types each system
+//			declares to read and write (ISystem::DeclareAccess): the systems
+//			that conflict run in registration order, the rest in parallel.
+// ----------------------------------------------------------------------------
+#ifndef AEX_SCHEDULER_H_
+#define AEX_SCHEDULER_H_
+
+#include "AEXJobSystem.h"
+#include <ostream>
+
+namespace AEX
+{
+	// ----------------------------------------------------------------------------
+	// \class	SystemScheduler
+	// \brief	The dependency graph is built when the systems change (an edge
+	//			from every system to the later ones it conflicts with) and run
+	//			every Update: a system is queued as a job when all its
+	//			predecessors are done. The MainThread systems are run by the
+	//			thread that calls Update, which helps with the jobs meanwhile.
+	class SystemScheduler : public ISystem
+	{
+		AEX_RTTI_DECL(SystemScheduler, ISystem);
+		AEX_SINGLETON(SystemScheduler);
+
+	public:
+		// one system in the last frame, times in seconds from the frame start
+		struct Timing
+		{
+			const char *	mName;
+			u32				mWorker;	// JobSystem worker index
+			f64				mStart;
+			f64				mEnd;
+		};
+
+		// ------------------------------------------------------------------------
+		// System Functions
+		virtual bool Initialize();
+		virtual void Update();		// runs the systems once, returns when all are done
+		void Shutdown();
+
+		// Registration. Conflicting systems run in the order they were added.
+		void AddSystem(ISystem * system);
+		void RemoveSystem(ISystem * system);
+		void ClearSystems();
+		void Rebuild();				// asks the systems for their access again
+
+		// false runs the systems one after the other (debugging)
+		void SetParallel(bool parallel) { mbParallel = parallel; }
+		bool GetParallel() const { return mbParallel; }
+
+		// Dependencies (system indices in registration order)
+		u32 GetSystemCount() const { return mSystems.size(); }
+		const std::vector<u32> & GetSuccessors(u32 system);
+
+		// Timeline of the last frame, one entry per system (registration order)
+		const std::vector<Timing> & GetTimeline() const { return mTimeline; }
+		f64 GetFrameTime() const { return mFrameTime; }
+		void WriteTimeline(std::ostream & o) const;	// chrome://tracing json
+
+	private:
+		void BuildGraph();
+		void Release(u32 node);					// all predecessors done
+		void RunNode(u32 node, u32 worker);		// Update and its timing
+		void Complete(u32 node);				// releases the successors
+
+		// registered systems and their graph
+		std::vector<ISystem*>			mSystems;
+		std::vector<SystemAccess>		mAccess;
+		std::vector<const char *>		mNames;
+		std::vector<std::vector<u32> >	mSuccessors;
+		std::vector<u32>				mPredecessorCount;
+		bool							mbGraphDirty;
+		bool							mbParallel;
+
+		// current frame
+		std::vector<std::atomic<u32> >	mPending;		// predecessors not done yet
+		std::atomic<u32>				mNodesLeft;
+		SpinLock						mMainLock;
+		std::vector<u32>				mMainReady;		// MainThread systems ready to run
+		f64								mFrameStart;
+		f64								mFrameTime;
+		std::vector<Timing>				mTimeline;
+	};
+}
+
+// Easy access to singleton
+#define aexScheduler (AEX::SystemScheduler::Instance())
+// ---------------------------------------------------------------------------
+
+#endif
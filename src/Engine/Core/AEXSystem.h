@@ -13,6 +13,66 @@
 
 namespace AEX
 {
+	///Component types (by Rtti) that the Update of a system reads and writes,
+	///filled by ISystem::DeclareAccess. The SystemScheduler runs two systems
+	///at the same time only if they don't conflict.
+	class SystemAccess
+	{
+	public:
+		SystemAccess() : mbExclusive(false), mbMainThread(false) {}
+
+		template <typename T> SystemAccess & Read()	{ return Read(T::TYPE()); }
+		template <typename T> SystemAccess & Write()	{ return Write(T::TYPE()); }
+		SystemAccess & Read(const Rtti & type)		{ mReads.push_back(&type); return *this; }
+		SystemAccess & Write(const Rtti & type)		{ mWrites.push_back(&type); return *this; }
+
+		///Conflicts with every other system (what isn't declared runs alone).
+		SystemAccess & Exclusive()					{ mbExclusive = true; return *this; }
+		///Always runs on the thread that updates the scheduler (OpenGL, windows).
+		SystemAccess & MainThread()					{ mbMainThread = true; return *this; }
+
+		///A write of one on a type the other reads or writes.
+		bool ConflictsWith(const SystemAccess & other) const
+		{
+			if (mbExclusive || other.mbExclusive)
+				return true;
+			FOR_EACH(it, mWrites)
+			{
+				if (Contains(other.mReads, *it) || Contains(other.mWrites, *it))
+					return true;
+			}
+			FOR_EACH(it, other.mWrites)
+			{
+				if (Contains(mReads, *it))
+					return true;
+			}
+			return false;
+		}
+
+		void Clear()
+		{
+			mReads.clear();
+			mWrites.clear();
+			mbExclusive = mbMainThread = false;
+		}
+
+		std::vector<const Rtti*>	mReads;
+		std::vector<const Rtti*>	mWrites;
+		bool						mbExclusive;
+		bool						mbMainThread;
+
+	private:
+		static bool Contains(const std::vector<const Rtti*> & types, const Rtti * type)
+		{
+			FOR_EACH(it, types)
+			{
+				if (*it == type)
+					return true;
+			}
+			return false;
+		}
+	};
+
 	///System is a pure virtual base class (which is to say, an interface) that is
 	///the base class for all systems used by the game. 
 	class ISystem : public IBase
@@ -26,6 +86,10 @@ namespace AEX
 
 		///Initialize the system.
 		virtual bool Initialize(){ return true; };
+
+		///Component types read and written by Update (see SystemScheduler).
+		///By default the system is exclusive.
+		virtual void DeclareAccess(SystemAccess & access){ access.Exclusive(); }
 		
 		///All systems need a virtual destructor to have their destructor called 
 		virtual ~ISystem(){}	
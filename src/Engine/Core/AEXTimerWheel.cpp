@@ -0,0 +1,282 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXTimerWheel.cpp
+// Purpose:	Implementation of the timer wheel.
+// ----------------------------------------------------------------------------
+#include "AEXTimerWheel.h"
+#include "..\Platform\AEXTime.h"
+#include <cmath>
+
+namespace AEX
+{
+	const u32 TimerWheel::LEVEL_BITS;
+	const u32 TimerWheel::LEVEL_SLOTS;
+	const u32 TimerWheel::LEVEL_COUNT;
+	const u32 TimerWheel::INVALID_INDEX;
+
+	TimerWheel::TimerWheel() : ISystem()
+		, mActiveCount(0)
+		, mQueuedCount(0)
+		, mbFiring(false)
+		, mTickLength(0.001)
+		, mTimeScale(1.0)
+		, mTime(0.0)
+		, mTick(0)
+	{
+		for (u32 i = 0; i < LEVEL_COUNT * LEVEL_SLOTS; ++i)
+			mHeads[i] = mTails[i] = INVALID_INDEX;
+	}
+
+	TimerWheel::~TimerWheel()
+	{
+		Shutdown();
+	}
+
+	bool TimerWheel::Initialize()
+	{
+		Shutdown();
+		return true;
+	}
+
+	void TimerWheel::Shutdown()
+	{
+		mNodes.clear();
+		mFreeNodes.clear();
+		for (u32 i = 0; i < LEVEL_COUNT * LEVEL_SLOTS; ++i)
+			mHeads[i] = mTails[i] = INVALID_INDEX;
+		mActiveCount = mQueuedCount = 0;
+		mExpired.clear();
+		mTime = 0.0;
+		mTick = 0;
+	}
+
+	void TimerWheel::Update()
+	{
+		Advance(aexTime->GetFrameTime());
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		Advance
+	// \brief	Processes the ticks up to the new time: the slots of the upper
+	//			levels that start at the tick cascade down, the level 0 slot
+	//			expires. The repeating timers are scheduled again right away
+	//			(several times if the period is shorter than the frame). The
+	//			callbacks run at the end, once the wheel is consistent.
+	// ----------------------------------------------------------------------------
+	void TimerWheel::Advance(f64 dt)
+	{
+		if (mbFiring)
+			return;		// from a callback
+
+		mTime += dt * mTimeScale;
+		u64 tick = static_cast<u64>(mTime / mTickLength);
+		while (mTick < tick)
+		{
+			if (!mQueuedCount)
+			{
+				mTick = tick;	// nothing to cascade or expire
+				break;
+			}
+			++mTick;
+
+			for (u32 level = 1; level < LEVEL_COUNT; ++level)
+			{
+				if (mTick & ((1ull << (level * LEVEL_BITS)) - 1))
+					break;
+				Cascade(level);
+			}
+
+			u32 slot = static_cast<u32>(mTick & (LEVEL_SLOTS - 1));
+			while (mHeads[slot] != INVALID_INDEX)
+			{
+				u32 index = mHeads[slot];
+				Node & node = mNodes[index];
+				Unlink(index);
+				mExpired.push_back((static_cast<u64>(node.mGeneration) << 32) | (index + 1));
+				if (node.mPeriod)
+				{
+					node.mDueTick += node.mPeriod;
+					Insert(index);
+				}
+			}
+		}
+		Fire();
+	}
+
+	TimerHandle TimerWheel::Schedule(f64 delay, const TimerFn & fn)
+	{
+		return Add(GetDueTick(delay), 0, fn);
+	}
+
+	TimerHandle TimerWheel::ScheduleRepeating(f64 period, const TimerFn & fn)
+	{
+		u64 ticks = static_cast<u64>(std::ceil(period / mTickLength - 0.000001));
+		return Add(GetDueTick(period), ticks ? ticks : 1, fn);
+	}
+
+	bool TimerWheel::Cancel(TimerHandle timer)
+	{
+		Node * node = GetNode(timer);
+		if (!node)
+			return false;
+		u32 index = static_cast<u32>(timer & 0xFFFFFFFF) - 1;
+		if (node->mSlot != INVALID_INDEX)
+			Unlink(index);
+		Free(index);
+		return true;
+	}
+
+	f64 TimerWheel::GetRemaining(TimerHandle timer) const
+	{
+		const Node * node = GetNode(timer);
+		if (!node)
+			return 0.0;
+		return (std::max)(0.0, node->mDueTick * mTickLength - mTime);
+	}
+
+	void TimerWheel::SetTickLength(f64 seconds)
+	{
+		if (mActiveCount || seconds <= 0.0)
+			return;		// the due ticks would change meaning
+		mTickLength = seconds;
+		mTick = static_cast<u64>(mTime / mTickLength);
+	}
+
+	TimerHandle TimerWheel::Add(u64 dueTick, u64 period, const TimerFn & fn)
+	{
+		u32 index;
+		if (mFreeNodes.empty())
+		{
+			index = mNodes.size();
+			mNodes.push_back(Node());
+			mNodes[index].mGeneration = 1;
+		}
+		else
+		{
+			index = mFreeNodes.back();
+			mFreeNodes.pop_back();
+		}
+
+		Node & node = mNodes[index];
+		node.mFn = fn;
+		node.mDueTick = dueTick;
+		node.mPeriod = period;
+		Insert(index);
+		mActiveCount++;
+		return (static_cast<u64>(node.mGeneration) << 32) | (index + 1);
+	}
+
+	TimerWheel::Node * TimerWheel::GetNode(TimerHandle timer)
+	{
+		return const_cast<Node*>(static_cast<const TimerWheel*>(this)->GetNode(timer));
+	}
+
+	const TimerWheel::Node * TimerWheel::GetNode(TimerHandle timer) const
+	{
+		u32 index = static_cast<u32>(timer & 0xFFFFFFFF) - 1;
+		if (index >= mNodes.size() || mNodes[index].mGeneration != static_cast<u32>(timer >> 32))
+			return NULL;
+		return &mNodes[index];
+	}
+
+	// The first tick at or after the time, at least the next one (a time on
+	// a tick, give or take the rounding, is that tick)
+	u64 TimerWheel::GetDueTick(f64 delay) const
+	{
+		u64 due = static_cast<u64>(std::ceil((mTime + delay) / mTickLength - 0.000001));
+		return due > mTick ? due : mTick + 1;
+	}
+
+	// To the level the delay fits in. The slot of level L is given by the
+	// due tick, it is reached (cascaded) when the time enters its span.
+	void TimerWheel::Insert(u32 index)
+	{
+		Node & node = mNodes[index];
+		const u64 range = 1ull << (LEVEL_COUNT * LEVEL_BITS);
+		u64 due = node.mDueTick - mTick < range ? node.mDueTick : mTick + range - 1;
+		u64 delta = due - mTick;
+
+		u32 level = 0;
+		while (delta >= (1ull << ((level + 1) * LEVEL_BITS)))
+			level++;
+		u32 slot = level * LEVEL_SLOTS + static_cast<u32>((due >> (level * LEVEL_BITS)) & (LEVEL_SLOTS - 1));
+
+		node.mSlot = slot;
+		node.mPrev = mTails[slot];
+		node.mNext = INVALID_INDEX;
+		if (mTails[slot] != INVALID_INDEX)
+			mNodes[mTails[slot]].mNext = index;
+		else
+			mHeads[slot] = index;
+		mTails[slot] = index;
+		mQueuedCount++;
+	}
+
+	void TimerWheel::Unlink(u32 index)
+	{
+		Node & node = mNodes[index];
+		if (node.mPrev != INVALID_INDEX)
+			mNodes[node.mPrev].mNext = node.mNext;
+		else
+			mHeads[node.mSlot] = node.mNext;
+		if (node.mNext != INVALID_INDEX)
+			mNodes[node.mNext].mPrev = node.mPrev;
+		else
+			mTails[node.mSlot] = node.mPrev;
+		node.mSlot = INVALID_INDEX;
+		mQueuedCount--;
+	}
+
+	void TimerWheel::Free(u32 index)
+	{
+		Node & node = mNodes[index];
+		node.mFn = nullptr;
+		node.mGeneration++;			// the handles given out are stale now
+		if (!node.mGeneration)
+			node.mGeneration = 1;
+		mFreeNodes.push_back(index);
+		mActiveCount--;
+	}
+
+	// The slot of the level that starts at this tick, to the lower levels
+	// (or further up again for the delays past the last level)
+	void TimerWheel::Cascade(u32 level)
+	{
+		u32 slot = level * LEVEL_SLOTS + static_cast<u32>((mTick >> (level * LEVEL_BITS)) & (LEVEL_SLOTS - 1));
+		u32 index = mHeads[slot];
+		mHeads[slot] = mTails[slot] = INVALID_INDEX;
+		while (index != INVALID_INDEX)
+		{
+			u32 next = mNodes[index].mNext;
+			mQueuedCount--;
+			Insert(index);
+			index = next;
+		}
+	}
+
+	// The callbacks of the timers that expired. A timer cancelled by an
+	// earlier callback of the batch doesn't fire.
+	void TimerWheel::Fire()
+	{
+		mbFiring = true;
+		for (u32 i = 0; i < mExpired.size(); ++i)
+		{
+			Node * node = GetNode(mExpired[i]);
+			if (!node)
+				continue;
+
+			// a copy, the callback can cancel its timer or schedule new ones
+			TimerFn fn;
+			if (node->mPeriod)
+				fn = node->mFn;
+			else
+			{
+				fn.swap(node->mFn);
+				Free(static_cast<u32>(mExpired[i] & 0xFFFFFFFF) - 1);
+			}
+			fn(mExpired[i]);
+		}
+		mExpired.clear();
+		mbFiring = false;
+	}
+}
@@ -0,0 +1,113 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXTimerWheel.h
+// Purpose:	Delayed callbacks and timeouts. The timers are kept in a
+//			hierarchical timer wheel advanced by the frame time, the ones due
+//			in a frame are called together, in due order, when it advances.
+// ----------------------------------------------------------------------------
+#ifndef AEX_TIMER_WHEEL_H_
+#define AEX_TIMER_WHEEL_H_
+
+#include "AEXSystem.h"
+#include <functional>
+
+namespace AEX
+{
+	// index + 1 in the low 32 bits, generation in the high ones. 0 is never
+	// a timer, the handle of a fired or cancelled timer is just stale.
+	typedef u64 TimerHandle;
+	const TimerHandle INVALID_TIMER = 0;
+
+	// fn(handle), a repeating timer can cancel itself with it
+	typedef std::function<void(TimerHandle)> TimerFn;
+
+	// ----------------------------------------------------------------------------
+	// \class	TimerWheel
+	// \brief	LEVEL_COUNT wheels of LEVEL_SLOTS slots, the slots of level L
+	//			are LEVEL_SLOTS^L ticks long. A timer goes to the level its
+	//			delay fits in and moves down (cascades) when the time reaches
+	//			its slot, so schedule and cancel are O(1) (the slots are
+	//			intrusive lists) and a tick only looks at one slot. The delays
+	//			past the last level wait in its farthest slot.
+	//			The time is the frame time times the time scale, 0 pauses.
+	//			Main thread only.
+	class TimerWheel : public ISystem
+	{
+		AEX_RTTI_DECL(TimerWheel, ISystem);
+		AEX_SINGLETON(TimerWheel);
+
+	public:
+		static const u32 LEVEL_BITS = 6;
+		static const u32 LEVEL_SLOTS = 1 << LEVEL_BITS;
+		static const u32 LEVEL_COUNT = 4;		// 64^4 ticks, 4.6 hours of 1 ms
+		static const u32 INVALID_INDEX = 0xFFFFFFFF;
+
+		virtual ~TimerWheel();
+
+		// ------------------------------------------------------------------------
+		// System Functions
+		virtual bool Initialize();
+		virtual void Update();					// aexTime's frame time
+		void Advance(f64 dt);					// same, with the given time
+		void Shutdown();						// drops the timers, time back to 0
+
+		// Timers, the delays are rounded up to the tick (at least one)
+		TimerHandle Schedule(f64 delay, const TimerFn & fn);
+		TimerHandle ScheduleRepeating(f64 period, const TimerFn & fn);	// first after one period
+		bool Cancel(TimerHandle timer);			// false if it already fired/was cancelled
+		bool IsActive(TimerHandle timer) const { return GetNode(timer) != NULL; }
+		f64  GetRemaining(TimerHandle timer) const;	// 0 if not active
+
+		// Settings
+		void SetTimeScale(f64 scale) { mTimeScale = scale; }
+		f64  GetTimeScale() const { return mTimeScale; }
+		void SetTickLength(f64 seconds);		// with no timer scheduled, default 1 ms
+		f64  GetTickLength() const { return mTickLength; }
+
+		f64 GetTime() const { return mTime; }	// scaled, since Initialize
+		u32 GetActiveCount() const { return mActiveCount; }
+
+	private:
+		struct Node
+		{
+			TimerFn	mFn;
+			u64		mDueTick;
+			u64		mPeriod;					// ticks, 0 for the timers that fire once
+			u32		mGeneration;
+			u32		mSlot;						// level * LEVEL_SLOTS + slot, INVALID_INDEX if in none
+			u32		mPrev;
+			u32		mNext;
+		};
+
+		TimerHandle Add(u64 dueTick, u64 period, const TimerFn & fn);
+		Node * GetNode(TimerHandle timer);
+		const Node * GetNode(TimerHandle timer) const;
+		u64 GetDueTick(f64 delay) const;
+		void Insert(u32 index);
+		void Unlink(u32 index);
+		void Free(u32 index);
+		void Cascade(u32 level);
+		void Fire();
+
+		std::vector<Node>			mNodes;
+		std::vector<u32>			mFreeNodes;
+		u32							mHeads[LEVEL_COUNT * LEVEL_SLOTS];	// slot lists, in schedule order
+		u32							mTails[LEVEL_COUNT * LEVEL_SLOTS];
+		u32							mActiveCount;
+		u32							mQueuedCount;	// in the slots
+
+		std::vector<TimerHandle>	mExpired;		// due during this Advance, in due order
+		bool						mbFiring;
+
+		f64							mTickLength;
+		f64							mTimeScale;
+		f64							mTime;
+		u64							mTick;			// last processed
+	};
+}
+
+// Easy access to singleton
+#define aexTimers (AEX::TimerWheel::Instance())
+// ---------------------------------------------------------------------------
+
+#endif
@@ -1,6 +1,7 @@
 #include "../Composition/AEXObjectManager.h"
 #include "WindowMgr.h"
 #include "GfxMgr.h"
+#include "RenderPipeline.h"
 
 #include <cassert>
 #include <iostream>
@@ -60,6 +61,7 @@ bool GraphicsManager::Initialize()
 	//glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 
 	WindowMgr->Initialize();
+	RenderPipe->Initialize();
 
 	int nrAttributes;
 	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &nrAttributes);
@@ -73,6 +75,12 @@ void GraphicsManager::Update()
 	
 }
 
+void GraphicsManager::DeclareAccess(SystemAccess & access)
+{
+	// the OpenGL context belongs to the main thread
+	access.MainThread().Exclusive();
+}
+
 void GraphicsManager::Render()
 {
 	if (!glfwWindowShouldClose(*WindowMgr->GetCurrentWindow()))
@@ -80,29 +88,33 @@ void GraphicsManager::Render()
 		// Window Input
 		WindowMgr->ProcessInput(*WindowMgr->GetCurrentWindow());
 
-		// Rendering commands
-		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT); // Clear the buffer
-
+		// Fill the frame, EndFrame clears, draws and swaps the buffers (or
+		// hands it to the render thread when pipelined)
+		RenderPipe->BeginFrame();
 		ObjMgr->Render();
+		RenderPipe->EndFrame();
 
-		// check and call events (poll IO events) and swap the buffers
+		// check and call events (poll IO events)
 		glfwPollEvents();
-		glfwSwapBuffers(*WindowMgr->GetCurrentWindow());
 	}
 	else
+	{
+		RenderPipe->Shutdown();
 		exit(1);
+	}
 }
 
 void GraphicsManager::Shutdown()
 {
+	RenderPipe->Shutdown();		// the context is back on this thread
 	mShaderList.clear();
 	glfwTerminate();
 }
 
 Shader * GraphicsManager::CreateShader(const char * shaderName, const char * vtxPath, const char * fragPath)
 {
-	Shader * tempShader = new Shader(vtxPath, fragPath);
+	Shader * tempShader = NULL;
+	RenderPipe->Execute([&tempShader, vtxPath, fragPath]() { tempShader = new Shader(vtxPath, fragPath); });
 	std::pair<Shader*, std::string> tempPair(tempShader, shaderName);
 	mShaderList.push_back(tempPair);
 	mCurrentShader = tempShader;
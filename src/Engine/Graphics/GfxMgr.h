@@ -13,6 +13,7 @@ class GraphicsManager : public ISystem
 public:
 	bool Initialize();
 	void Update();
+	void DeclareAccess(SystemAccess & access);
 	void Render();
 	void Shutdown();
 
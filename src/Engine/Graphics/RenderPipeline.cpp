@@ -0,0 +1,220 @@
+#include "RenderPipeline.h"
+#include "WindowMgr.h"
+
+RenderPipeline::RenderPipeline()
+	: mWriteIndex(0)
+	, mFrameCount(0)
+	, mbPipelined(false)
+	, mbFrameReady(false)
+	, mbQuit(false)
+	, mCommandsQueued(0)
+	, mCommandsDone(0)
+{}
+
+RenderPipeline::~RenderPipeline()
+{
+	Shutdown();
+}
+
+bool RenderPipeline::Initialize()
+{
+	for (u32 i = 0; i < 2; ++i)
+	{
+		mSnapshots[i].mItems.clear();
+		mSnapshots[i].mClearColor[0] = 0.2f;
+		mSnapshots[i].mClearColor[1] = 0.3f;
+		mSnapshots[i].mClearColor[2] = 0.3f;
+		mSnapshots[i].mClearColor[3] = 1.0f;
+		mSnapshots[i].mFrame = 0;
+	}
+	mWriteIndex = 0;
+	mFrameCount = 0;
+	return true;
+}
+
+void RenderPipeline::Shutdown()
+{
+	SetPipelined(false);
+}
+
+// The context can only be current on one thread: released by the main thread
+// before the render thread takes it, and taken back after it is joined.
+void RenderPipeline::SetPipelined(bool pipelined)
+{
+	if (pipelined == mbPipelined)
+		return;
+
+	if (pipelined)
+	{
+		mbQuit = false;
+		mbFrameReady = false;
+		glfwMakeContextCurrent(NULL);
+		mbPipelined = true;
+		mThread = std::thread(&RenderPipeline::RenderLoop, this);
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mbQuit = true;
+		}
+		mWakeCV.notify_one();
+		mThread.join();		// draws what was handed to it first
+		mbPipelined = false;
+		glfwMakeContextCurrent(*WindowMgr->GetCurrentWindow());
+	}
+}
+
+RenderSnapshot & RenderPipeline::BeginFrame()
+{
+	RenderSnapshot & snapshot = mSnapshots[mWriteIndex];
+	snapshot.mItems.clear();
+	snapshot.mFrame = mFrameCount;
+	return snapshot;
+}
+
+void RenderPipeline::EndFrame()
+{
+	if (!mbPipelined)
+	{
+		Submit(mSnapshots[mWriteIndex]);
+		mFrameCount++;
+		return;
+	}
+
+	{
+		// at most one frame in flight: the render thread is done reading the
+		// other snapshot once the previous frame was drawn
+		std::unique_lock<std::mutex> lock(mMutex);
+		mDoneCV.wait(lock, [this]() { return !mbFrameReady; });
+
+		mFrameCommands.insert(mFrameCommands.end(), mCommands.begin(), mCommands.end());
+		mCommands.clear();
+		mWriteIndex = 1 - mWriteIndex;
+		mbFrameReady = true;
+	}
+	mWakeCV.notify_one();
+	mFrameCount++;
+}
+
+void RenderPipeline::Flush()
+{
+	if (!mbPipelined)
+		return;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDoneCV.wait(lock, [this]() { return !mbFrameReady && mCommandsDone == mCommandsQueued; });
+}
+
+void RenderPipeline::Execute(const std::function<void()> & fn)
+{
+	if (!mbPipelined || std::this_thread::get_id() == mThread.get_id())
+	{
+		fn();
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mCommands.push_back(fn);
+	u64 ticket = ++mCommandsQueued;
+	mWakeCV.notify_one();
+	mDoneCV.wait(lock, [this, ticket]() { return mCommandsDone >= ticket; });
+}
+
+void RenderPipeline::Post(const std::function<void()> & fn)
+{
+	if (!mbPipelined || std::this_thread::get_id() == mThread.get_id())
+	{
+		fn();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mCommands.push_back(fn);
+		++mCommandsQueued;
+	}
+	mWakeCV.notify_one();
+}
+
+// Draws the snapshot on the thread that owns the context, the state only
+// changes between items when it has to.
+void RenderPipeline::Submit(const RenderSnapshot & snapshot)
+{
+	glClearColor(snapshot.mClearColor[0], snapshot.mClearColor[1], snapshot.mClearColor[2], snapshot.mClearColor[3]);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	unsigned int shader = 0, texture = 0, vao = 0;
+	GLint transformLoc = -1;
+	FOR_EACH(it, snapshot.mItems)
+	{
+		if (it->mShader != shader)
+		{
+			shader = it->mShader;
+			glUseProgram(shader);
+			transformLoc = glGetUniformLocation(shader, "transform");
+		}
+		if (it->mTexture != texture)
+		{
+			texture = it->mTexture;
+			glBindTexture(GL_TEXTURE_2D, texture);
+		}
+		if (it->mVAO != vao)
+		{
+			vao = it->mVAO;
+			glBindVertexArray(vao);
+		}
+		glUniformMatrix4fv(transformLoc, 1, GL_FALSE, &it->mModelToWorld.m[0][0]);
+		glDrawElements(GL_TRIANGLES, it->mIndexCount, GL_UNSIGNED_INT, 0);
+	}
+	glBindVertexArray(0);
+
+	glfwSwapBuffers(*WindowMgr->GetCurrentWindow());
+}
+
+void RenderPipeline::RunCommands(std::vector<std::function<void()> > & commands, std::unique_lock<std::mutex> & lock)
+{
+	if (commands.empty())
+		return;
+
+	std::vector<std::function<void()> > run;
+	run.swap(commands);
+	lock.unlock();
+	FOR_EACH(it, run)
+		(*it)();
+	lock.lock();
+
+	mCommandsDone += run.size();
+	mDoneCV.notify_all();
+}
+
+// A frame is drawn after the commands queued before its EndFrame and before
+// the ones queued after it. On quit what was already handed over is drawn.
+void RenderPipeline::RenderLoop()
+{
+	glfwMakeContextCurrent(*WindowMgr->GetCurrentWindow());
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;)
+	{
+		mWakeCV.wait(lock, [this]() { return mbQuit || mbFrameReady || !mCommands.empty(); });
+
+		if (mbFrameReady)
+		{
+			RunCommands(mFrameCommands, lock);
+
+			lock.unlock();
+			Submit(mSnapshots[1 - mWriteIndex]);
+			lock.lock();
+
+			mbFrameReady = false;
+			mDoneCV.notify_all();
+		}
+		else if (!mCommands.empty())
+			RunCommands(mCommands, lock);
+		else if (mbQuit)
+			break;
+	}
+
+	glfwMakeContextCurrent(NULL);
+}
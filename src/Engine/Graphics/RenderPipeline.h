@@ -0,0 +1,86 @@
+#pragma once
+#include "../Core/AEXSystem.h"
+#include <./extern/aexmath/aexmath/AEXMath.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using namespace AEX;
+
+// ----------------------------------------------------------------------------
+// Everything the render thread needs to draw one object, copied out of the
+// game objects so the simulation can change them while the frame is drawn.
+struct RenderItem
+{
+	AEMtx44			mModelToWorld;
+	unsigned int	mShader;		// program ID
+	unsigned int	mTexture;
+	unsigned int	mVAO;
+	unsigned int	mIndexCount;
+};
+
+struct RenderSnapshot
+{
+	std::vector<RenderItem>	mItems;
+	f32						mClearColor[4];
+	u64						mFrame;
+};
+
+// ----------------------------------------------------------------------------
+// Submits the RenderSnapshots. By default on the calling thread, right away.
+// Pipelined, a render thread owns the GL context and draws frame N while the
+// main thread simulates frame N + 1 (one frame of latency, at most one frame
+// in flight). The GL calls made outside of Submit (resources) have to go
+// through Execute/Post so they run on the thread that owns the context.
+class RenderPipeline : public ISystem
+{
+	AEX_RTTI_DECL(RenderPipeline, ISystem);
+	AEX_SINGLETON(RenderPipeline);
+
+public:
+	virtual ~RenderPipeline();
+
+	bool Initialize();
+	void Shutdown();						// stops the render thread, the context is back on the caller
+
+	// Switches mode, the calling thread must be the main thread (the one
+	// with the context when not pipelined).
+	void SetPipelined(bool pipelined);
+	bool IsPipelined() const { return mbPipelined; }
+
+	// Frame: fill the snapshot between BeginFrame and EndFrame
+	RenderSnapshot & BeginFrame();
+	RenderSnapshot & GetFrame() { return mSnapshots[mWriteIndex]; }
+	void EndFrame();						// draws it or hands it to the render thread
+	void Flush();							// waits until the render thread is idle
+
+	// GL work on the thread that owns the context, in the order it was
+	// queued and before the frames ended after it. Execute waits for it,
+	// Post doesn't.
+	void Execute(const std::function<void()> & fn);
+	void Post(const std::function<void()> & fn);
+
+private:
+	void Submit(const RenderSnapshot & snapshot);
+	void RenderLoop();
+	void RunCommands(std::vector<std::function<void()> > & commands, std::unique_lock<std::mutex> & lock);
+
+	RenderSnapshot							mSnapshots[2];
+	u32										mWriteIndex;	// filled by the main thread
+	u64										mFrameCount;
+
+	bool									mbPipelined;
+	std::thread								mThread;
+	std::mutex								mMutex;
+	std::condition_variable					mWakeCV;		// frame or commands for the render thread
+	std::condition_variable					mDoneCV;		// render thread idle / command done
+	bool									mbFrameReady;	// mSnapshots[1 - mWriteIndex] waiting to be drawn
+	bool									mbQuit;
+	std::vector<std::function<void()> >		mCommands;		// queued after the last EndFrame
+	std::vector<std::function<void()> >		mFrameCommands;	// run before the frame waiting to be drawn
+	u64										mCommandsQueued;
+	u64										mCommandsDone;
+};
+
+#define RenderPipe (RenderPipeline::Instance())
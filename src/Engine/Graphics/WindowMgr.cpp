@@ -59,6 +59,12 @@ void WindowManager2::Update()
 
 }
 
+void WindowManager2::DeclareAccess(SystemAccess & access)
+{
+	// glfw windows can only be used from the main thread
+	access.MainThread().Exclusive();
+}
+
 void WindowManager2::Shutdown()
 {
 	for (auto it = mWindowList.begin(); it != mWindowList.end(); it++)
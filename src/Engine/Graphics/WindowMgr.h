@@ -38,6 +38,7 @@ public:
 
 	bool Initialize();
 	void Update();
+	void DeclareAccess(SystemAccess & access);
 	void Shutdown();
 
 private:
@@ -1,40 +1,256 @@
 #include "AEXLogic.h"
+#include "AEXScript.h"
+#include "..\Core\AEXEventBus.h"
+#include "..\Platform\AEXTime.h"
 
 namespace AEX
 {
 	//-------------------------------------------------------------------------
 	#pragma region // Base Logic Component
 
-	LogicComp::LogicComp() : IComp() {}
+	LogicComp::LogicComp() : IComp()
+		, mTier(LTIER_EVERY_FRAME), mInterval(1)
+		, mLogicGroup(Logic::INVALID_INDEX), mLogicSlot(Logic::INVALID_INDEX)
+		, mLastUpdateFrame(0) {}
 	void LogicComp::Initialize() {
 		Logic::Instance()->AddComp(this);
 	}
 	void LogicComp::Shutdown() {
 		Logic::Instance()->RemoveComp(this);
 	}
+	void LogicComp::SetEnabled(bool enabled) {
+		IComp::SetEnabled(enabled);
+		if (mLogicGroup != Logic::INVALID_INDEX)
+			Logic::Instance()->UpdateEnabled(this);
+	}
+	void LogicComp::SetUpdateTier(ELogicTier tier, u32 interval) {
+		// to the group of the new tier
+		bool added = mLogicGroup != Logic::INVALID_INDEX;
+		if (added)
+			Logic::Instance()->RemoveComp(this);
+		mTier = tier;
+		mInterval = (tier == LTIER_EVERY_N && interval > 1) ? interval : 1;
+		if (added)
+			Logic::Instance()->AddComp(this);
+	}
 	#pragma endregion
 
 	//-------------------------------------------------------------------------
 	#pragma region // Logic System
-	Logic::Logic() {}
+	const u32 Logic::INVALID_INDEX;
+
+	Logic::Logic()
+		: mSliceGroup(0)
+		, mBudget(1000.0)
+		, mStarvationFrames(60)
+		, mFrame(0)
+	{
+		mStats.mUpdated = mStats.mSliced = 0;
+		mStats.mSlicedTime = 0.0;
+		mStats.mOverruns = mStats.mStarvations = 0;
+		mStats.mWorstOverrun = 0.0;
+	}
+
+	bool Logic::GroupKey::operator<(const GroupKey & rhs) const
+	{
+		if (mType != rhs.mType)
+			return mType < rhs.mType;
+		if (mTier != rhs.mTier)
+			return mTier < rhs.mTier;
+		return mInterval < rhs.mInterval;
+	}
 
 	void Logic::Update()
 	{
-		FOR_EACH(comp, mComps)
-			/*TODO:if((*comp)->Enabled())*/
-			(*comp)->Update();
+		aexScripts->Update();	// the scripts waiting for this frame
+
+		mFrame++;
+		mStats.mUpdated = 0;
+		mStats.mSliced = 0;
+		mStats.mSlicedTime = 0.0;
+
+		// indices, the components can add or remove components
+		for (u32 g = 0; g < mGroups.size(); ++g)
+		{
+			if (mGroups[g].mTier == LTIER_EVERY_FRAME)
+			{
+				for (u32 i = 0; i < mGroups[g].mEnabledCount; ++i)
+					UpdateComp(mGroups[g].mComps[i]);
+			}
+			else if (mGroups[g].mTier == LTIER_EVERY_N)
+				UpdateEveryN(g);
+		}
+		UpdateSliced();
+	}
+
+	void Logic::UpdateComp(LogicComp * logicComp)
+	{
+		logicComp->mLastUpdateFrame = mFrame;
+		logicComp->Update();
+		mStats.mUpdated++;
+	}
+
+	// The next 1/N of the enabled components, every one once per N frames
+	// (the remainder of E/N spread over the frames, E*f/N - E*(f-1)/N)
+	void Logic::UpdateEveryN(u32 g)
+	{
+		u64 enabled = mGroups[g].mEnabledCount, interval = mGroups[g].mInterval;
+		u32 count = static_cast<u32>((enabled * mFrame) / interval - (enabled * (mFrame - 1)) / interval);
+		for (u32 i = 0; i < count; ++i)
+		{
+			Group & group = mGroups[g];
+			if (!group.mEnabledCount)
+				return;
+			if (group.mCursor >= group.mEnabledCount)
+				group.mCursor = 0;
+			UpdateComp(group.mComps[group.mCursor++]);
+		}
+	}
+
+	// Continues where the last frame stopped, group by group, until the
+	// budget is spent or every component was updated once. The time is
+	// checked after each update, the one that crosses the budget overruns.
+	void Logic::UpdateSliced()
+	{
+		if (mSlicedGroups.empty())
+			return;
+
+		u32 total = 0;
+		FOR_EACH(it, mSlicedGroups)
+			total += mGroups[*it].mEnabledCount;
+
+		const f64 budget = mBudget * 0.000001;
+		const f64 start = FRC::GetCPUTime();
+		f64 elapsed = 0.0;
+		LogicComp * last = NULL;
+		u32 emptyGroups = 0;
+		while (mStats.mSliced < total)
+		{
+			Group & group = mGroups[mSlicedGroups[mSliceGroup]];
+			if (group.mCursor >= group.mEnabledCount)
+			{
+				group.mCursor = 0;
+				mSliceGroup = (mSliceGroup + 1) % mSlicedGroups.size();
+				if (++emptyGroups > mSlicedGroups.size())
+					break;	// components removed meanwhile
+				continue;
+			}
+			emptyGroups = 0;
+
+			LogicComp * logicComp = group.mComps[group.mCursor++];
+			u32 waited = static_cast<u32>(mFrame - logicComp->mLastUpdateFrame);
+			if (waited > mStarvationFrames)
+			{
+				mStats.mStarvations++;
+				Report(LBEVENT_STARVED, logicComp, 0.0, waited);
+			}
+			UpdateComp(logicComp);
+			mStats.mSliced++;
+			last = logicComp;
+
+			elapsed = FRC::GetCPUTime() - start;
+			if (elapsed >= budget)
+				break;
+		}
+		mStats.mSlicedTime = elapsed;
+
+		if (elapsed > budget)
+		{
+			mStats.mOverruns++;
+			mStats.mWorstOverrun = (std::max)(mStats.mWorstOverrun, elapsed - budget);
+			Report(LBEVENT_OVERRUN, last, elapsed - budget, 0);
+		}
+	}
+
+	void Logic::Report(ELogicBudgetEvent type, LogicComp * logicComp, f64 overrun, u32 waited)
+	{
+		if (!aexEvents->HasSubscribers<LogicBudgetEvent>())
+			return;
+		LogicBudgetEvent ev = { type, logicComp, mFrame, overrun, waited };
+		aexEvents->Publish(ev);
 	}
 
 	// component management
-	void Logic::AddComp(IComp * logicComp) {
-		mComps.remove(logicComp); // no duplicates
-		mComps.push_back(logicComp);
+	void Logic::AddComp(LogicComp * logicComp) {
+		if (logicComp->mLogicGroup != INVALID_INDEX)
+			return; // no duplicates
+
+		// group of its concrete type and tier
+		GroupKey key = { &logicComp->GetType(), logicComp->mTier, logicComp->mInterval };
+		auto it = mGroupIndex.find(key);
+		if (it == mGroupIndex.end())
+		{
+			Group group = { key.mType, key.mTier, key.mInterval, std::vector<LogicComp *>(), 0, 0 };
+			mGroups.push_back(group);
+			if (key.mTier == LTIER_TIME_SLICED)
+				mSlicedGroups.push_back(mGroups.size() - 1);
+			it = mGroupIndex.insert(std::make_pair(key, mGroups.size() - 1)).first;
+		}
+
+		Group & group = mGroups[it->second];
+		logicComp->mLogicGroup = it->second;
+		logicComp->mLogicSlot = group.mComps.size();
+		logicComp->mLastUpdateFrame = mFrame;	// waits from now
+		group.mComps.push_back(logicComp);
+		UpdateEnabled(logicComp);
 	}
-	void Logic::RemoveComp(IComp * logicComp) {
-		mComps.remove(logicComp);
+	void Logic::RemoveComp(LogicComp * logicComp) {
+		if (logicComp->mLogicGroup == INVALID_INDEX)
+			return;
+
+		Group & group = mGroups[logicComp->mLogicGroup];
+		u32 slot = logicComp->mLogicSlot;
+
+		// out of the enabled range first, then swap with the last
+		if (slot < group.mEnabledCount)
+		{
+			Swap(group, slot, group.mEnabledCount - 1);
+			slot = --group.mEnabledCount;
+		}
+		Swap(group, slot, group.mComps.size() - 1);
+		group.mComps.pop_back();
+
+		logicComp->mLogicGroup = INVALID_INDEX;
+		logicComp->mLogicSlot = INVALID_INDEX;
 	}
 	void Logic::ClearComps() {
-		mComps.clear();
+		FOR_EACH(group, mGroups)
+		{
+			FOR_EACH(comp, group->mComps)
+			{
+				(*comp)->mLogicGroup = INVALID_INDEX;
+				(*comp)->mLogicSlot = INVALID_INDEX;
+			}
+		}
+		mGroups.clear();
+		mGroupIndex.clear();
+		mSlicedGroups.clear();
+		mSliceGroup = 0;
+	}
+
+	u32 Logic::GetCompCount() const {
+		u32 count = 0;
+		FOR_EACH(group, mGroups)
+			count += group->mComps.size();
+		return count;
+	}
+
+	// Moves the component to the side of the partition that matches mbEnabled
+	void Logic::UpdateEnabled(LogicComp * logicComp) {
+		Group & group = mGroups[logicComp->mLogicGroup];
+		u32 slot = logicComp->mLogicSlot;
+		if (logicComp->mbEnabled && slot >= group.mEnabledCount)
+			Swap(group, slot, group.mEnabledCount++);
+		else if (!logicComp->mbEnabled && slot < group.mEnabledCount)
+			Swap(group, slot, --group.mEnabledCount);
+	}
+
+	void Logic::Swap(Group & group, u32 a, u32 b) {
+		if (a == b)
+			return;
+		std::swap(group.mComps[a], group.mComps[b]);
+		group.mComps[a]->mLogicSlot = a;
+		group.mComps[b]->mLogicSlot = b;
 	}
 
 	#pragma endregion
@@ -4,6 +4,14 @@
 
 namespace AEX
 {
+	// How often Logic updates a component
+	enum ELogicTier
+	{
+		LTIER_EVERY_FRAME,	// every frame
+		LTIER_EVERY_N,		// once every N frames, spread over the N frames
+		LTIER_TIME_SLICED	// round-robin, as many as fit in Logic's budget
+	};
+
 	class LogicComp : public IComp
 	{
 		AEX_RTTI_DECL(LogicComp, IComp);
@@ -11,21 +19,118 @@ namespace AEX
 		LogicComp();
 		void Initialize();
 		void Shutdown();
+		virtual void SetEnabled(bool enabled);	// moves it in its Logic group
+
+		// interval only for LTIER_EVERY_N. Can be changed after Initialize.
+		void SetUpdateTier(ELogicTier tier, u32 interval = 1);
+		ELogicTier GetUpdateTier() const { return mTier; }
+		u32 GetUpdateInterval() const { return mInterval; }
+		u64 GetLastUpdateFrame() const { return mLastUpdateFrame; }	// Logic frame
+
+	private:
+		friend class Logic;
+		ELogicTier	mTier;
+		u32			mInterval;
+		u32			mLogicGroup;		// index in Logic, INVALID_INDEX when not added
+		u32			mLogicSlot;
+		u64			mLastUpdateFrame;
+	};
+
+	// Published on the event bus (see Logic)
+	enum ELogicBudgetEvent
+	{
+		LBEVENT_OVERRUN,	// the time-sliced updates went over the budget
+		LBEVENT_STARVED		// a time-sliced component waited too many frames
+	};
+	struct LogicBudgetEvent
+	{
+		ELogicBudgetEvent	mType;
+		LogicComp *			mComp;		// the last one updated / the starved one
+		u64					mFrame;
+		f64					mOverrun;	// seconds over the budget
+		u32					mWaited;	// frames since its previous update
 	};
 
+	// Updates the logic components grouped by concrete type and tier (same
+	// virtual Update back to back). Each group is a dense array with the
+	// enabled components first, the disabled ones are never visited.
+	// LTIER_EVERY_N groups update 1/N of their components per frame and the
+	// time-sliced ones share a per-frame budget, from where they stopped.
 	class Logic :public ISystem
 	{
 		AEX_RTTI_DECL(Logic, ISystem);
 		AEX_SINGLETON(Logic);
 
 	public:
+		static const u32 INVALID_INDEX = 0xFFFFFFFF;
+
+		struct Stats
+		{
+			u32 mUpdated;			// last frame, all tiers
+			u32 mSliced;			// last frame, time-sliced
+			f64 mSlicedTime;		// last frame, seconds
+			u64 mOverruns;			// totals
+			u64 mStarvations;
+			f64 mWorstOverrun;
+		};
+
+		// Every frame tier first, then every N, then time-sliced. Group by
+		// group, in the order they were created. A component added or
+		// removed during the update may be skipped until the next one.
 		virtual void Update();
 
-		// component management
-		void AddComp(IComp * logicComp);
-		void RemoveComp(IComp * logicComp);
+		// component management, O(1)
+		void AddComp(LogicComp * logicComp);
+		void RemoveComp(LogicComp * logicComp);
 		void ClearComps();
+
+		u32 GetCompCount() const;
+		u32 GetGroupCount() const { return mGroups.size(); }
+
+		// Time-sliced tier. At least one component is updated per frame.
+		void SetBudget(f64 microseconds) { mBudget = microseconds; }
+		f64  GetBudget() const { return mBudget; }
+		void SetStarvationFrames(u32 frames) { mStarvationFrames = frames; }
+		u32  GetStarvationFrames() const { return mStarvationFrames; }
+
+		u64 GetFrame() const { return mFrame; }
+		const Stats & GetStats() const { return mStats; }
+
 	private:
-		std::list<IComp *> mComps;
+		friend class LogicComp;
+
+		struct Group
+		{
+			const Rtti *				mType;
+			ELogicTier					mTier;
+			u32							mInterval;
+			std::vector<LogicComp *>	mComps;			// [0, mEnabledCount) enabled
+			u32							mEnabledCount;
+			u32							mCursor;		// next one, round-robin tiers
+		};
+		struct GroupKey
+		{
+			const Rtti *	mType;
+			ELogicTier		mTier;
+			u32				mInterval;
+			bool operator<(const GroupKey & rhs) const;
+		};
+
+		void UpdateEnabled(LogicComp * logicComp);		// after SetEnabled
+		void Swap(Group & group, u32 a, u32 b);
+		void UpdateComp(LogicComp * logicComp);
+		void UpdateEveryN(u32 group);
+		void UpdateSliced();
+		void Report(ELogicBudgetEvent type, LogicComp * logicComp, f64 overrun, u32 waited);
+
+		std::vector<Group>				mGroups;
+		std::map<GroupKey, u32>			mGroupIndex;
+		std::vector<u32>				mSlicedGroups;	// time-sliced groups, round-robin
+		u32								mSliceGroup;	// in mSlicedGroups
+
+		f64								mBudget;		// microseconds
+		u32								mStarvationFrames;
+		u64								mFrame;
+		Stats							mStats;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include "AEXScript.h"
+
+namespace AEX
+{
+	//-------------------------------------------------------------------------
+	#pragma region // Script Component
+	const s32 ScriptComp::SCRIPT_FINISHED;
+
+	ScriptComp::ScriptComp() : LogicComp()
+		, mScriptLine(0)
+		, mWaitList(NULL)
+		, mWaitCollider(NULL)
+		, mTimer(INVALID_TIMER)
+		, mbPaused(false)
+	{
+		mLastCollision.mType = CEVENT_BEGIN;
+		mLastCollision.mBody1 = mLastCollision.mBody2 = NULL;
+		mLastCollision.mKey = 0;
+	}
+	void ScriptComp::Initialize() {
+		// not added to Logic, the scheduler resumes it
+		aexScripts->Cancel(this);
+		mScriptLine = 0;
+		Resume();
+	}
+	void ScriptComp::Shutdown() {
+		aexScripts->Cancel(this);
+		mbPaused = false;
+	}
+	void ScriptComp::SetEnabled(bool enabled) {
+		IComp::SetEnabled(enabled);
+		if (enabled && mbPaused)
+		{
+			mbPaused = false;
+			aexScripts->WaitFrame(this);
+		}
+	}
+	void ScriptComp::Restart() {
+		aexScripts->Cancel(this);
+		mbPaused = false;
+		mScriptLine = 0;
+		aexScripts->WaitFrame(this);
+	}
+	void ScriptComp::Resume() {
+		if (IsFinished())
+			return;
+		if (!IsEnabled())
+		{
+			mbPaused = true;	// continues when enabled
+			return;
+		}
+		Run();
+	}
+	#pragma endregion
+
+	//-------------------------------------------------------------------------
+	#pragma region // Script Scheduler
+	ScriptScheduler::ScriptScheduler() : ISystem()
+		, mResumingList(NULL)
+		, mCollisionSubscription(0)
+	{}
+
+	ScriptScheduler::~ScriptScheduler()
+	{
+		Shutdown();
+	}
+
+	bool ScriptScheduler::Initialize()
+	{
+		Shutdown();
+		return true;
+	}
+
+	// The frame waits of the last frame (the ones added while resuming wait
+	// for the next one)
+	void ScriptScheduler::Update()
+	{
+		ResumeAll(mNextFrame);
+	}
+
+	void ScriptScheduler::Shutdown()
+	{
+		// the scripts still waiting forget their lists (the time waits are
+		// dropped with aexTimers)
+		ResetWaits(mNextFrame);
+		ResetWaits(mResuming);
+		FOR_EACH(it, mCollisionWaiters)
+			ResetWaits(it->second);
+		mCollisionWaiters.clear();
+
+		FOR_EACH(it, mEventWaiters)
+		{
+			ResetWaits(it->second->mWaiters);
+			aexEvents->Unsubscribe(it->second->mSubscription);
+			delete it->second;
+		}
+		mEventWaiters.clear();
+		if (mCollisionSubscription)
+			aexEvents->Unsubscribe(mCollisionSubscription);
+		mCollisionSubscription = 0;
+	}
+
+	void ScriptScheduler::WaitFrame(ScriptComp * script)
+	{
+		Wait(script, mNextFrame);
+	}
+
+	void ScriptScheduler::WaitSeconds(ScriptComp * script, f64 seconds)
+	{
+		Cancel(script);
+		script->mTimer = aexTimers->Schedule(seconds, [script](TimerHandle)
+		{
+			script->mTimer = INVALID_TIMER;
+			script->Resume();
+		});
+	}
+
+	void ScriptScheduler::WaitCollision(ScriptComp * script, Collider * collider)
+	{
+		if (!mCollisionSubscription)
+		{
+			mCollisionSubscription = aexEvents->Subscribe<CollisionEvent>([this](const CollisionEvent * events, u32 count)
+			{
+				OnCollisions(events, count);
+			});
+		}
+		Cancel(script);		// before the lookup, it can erase the entry
+		Wait(script, mCollisionWaiters[collider]);
+		script->mWaitCollider = collider;
+	}
+
+	void ScriptScheduler::Wait(ScriptComp * script, WaiterList & list)
+	{
+		Cancel(script);		// one wait at a time
+		Waiter waiter = { script };
+		list.push_back(waiter);
+		script->mWaitList = &list;
+	}
+
+	void ScriptScheduler::Cancel(ScriptComp * script)
+	{
+		if (script->mWaitList)
+		{
+			WaiterList & list = *static_cast<WaiterList*>(script->mWaitList);
+			for (u32 i = 0; i < list.size(); ++i)
+			{
+				if (list[i].mScript == script)
+				{
+					list[i] = list.back();
+					list.pop_back();
+					break;
+				}
+			}
+
+			// nobody waits on the collider anymore
+			if (script->mWaitCollider && list.empty() && &list != mResumingList)
+				mCollisionWaiters.erase(script->mWaitCollider);
+			script->mWaitList = NULL;
+			script->mWaitCollider = NULL;
+		}
+		if (script->mTimer != INVALID_TIMER)
+		{
+			aexTimers->Cancel(script->mTimer);
+			script->mTimer = INVALID_TIMER;
+		}
+
+		// taken out of its list already, about to be resumed
+		FOR_EACH(it, mResuming)
+		{
+			if (it->mScript == script)
+				it->mScript = NULL;
+		}
+	}
+
+	void ScriptScheduler::ResumeAll(WaiterList & waiters)
+	{
+		if (waiters.empty())
+			return;
+
+		// the scripts resumed here can wait in the same list again
+		mResuming.clear();
+		mResuming.swap(waiters);
+		mResumingList = &waiters;
+		for (u32 i = 0; i < mResuming.size(); ++i)
+		{
+			ScriptComp * script = mResuming[i].mScript;
+			if (script)
+			{
+				script->mWaitList = NULL;
+				script->mWaitCollider = NULL;
+				script->Resume();
+			}
+		}
+
+		// keep the capacity of the list
+		mResuming.clear();
+		if (waiters.empty())
+			waiters.swap(mResuming);
+		mResumingList = NULL;
+	}
+
+	void ScriptScheduler::ResetWaits(WaiterList & waiters)
+	{
+		FOR_EACH(it, waiters)
+		{
+			if (it->mScript)
+			{
+				it->mScript->mWaitList = NULL;
+				it->mScript->mWaitCollider = NULL;
+			}
+		}
+		waiters.clear();
+	}
+
+	// The waiters of both colliders of each pair that started touching
+	void ScriptScheduler::OnCollisions(const CollisionEvent * events, u32 count)
+	{
+		for (u32 i = 0; i < count; ++i)
+		{
+			if (events[i].mType != CEVENT_BEGIN)
+				continue;
+
+			Collider * bodies[2] = { events[i].mBody1, events[i].mBody2 };
+			for (u32 b = 0; b < 2; ++b)
+			{
+				auto it = mCollisionWaiters.find(bodies[b]);
+				if (it == mCollisionWaiters.end() || it->second.empty())
+					continue;
+				FOR_EACH(w, it->second)
+					w->mScript->mLastCollision = events[i];
+				ResumeAll(it->second);
+
+				// unless they wait on it again
+				if (it->second.empty())
+					mCollisionWaiters.erase(it);
+			}
+		}
+	}
+	#pragma endregion
+}
\ No newline at end of file
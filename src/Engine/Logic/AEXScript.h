@@ -0,0 +1,175 @@
+#pragma once
+#include "AEXLogic.h"
+#include "..\Core\AEXEventBus.h"
+#include "..\Core\AEXTimerWheel.h"
+#include "..\Physics\AEXCollisionSystem.h"
+
+// ----------------------------------------------------------------------------
+// Scripts: logic written as a sequence that waits (for frames, time, events or
+// collisions) instead of an Update that polls. A ScriptComp implements Run()
+// between AEX_SCRIPT_BEGIN and AEX_SCRIPT_END, every AEX_WAIT_* returns from
+// Run and the next Run continues after it:
+//
+//	void Run()
+//	{
+//		AEX_SCRIPT_BEGIN;
+//		for (mShots = 0; mShots < 3; ++mShots)
+//		{
+//			Fire();
+//			AEX_WAIT_SECONDS(0.5);
+//		}
+//		AEX_WAIT_COLLISION(mTrigger);
+//		Open();
+//		AEX_SCRIPT_END;
+//	}
+//
+// Stackless (a switch on the resume point, C++14 has no coroutines): the
+// local variables don't survive a wait, keep the state in members, and a
+// wait can't be inside a switch of Run.
+// ----------------------------------------------------------------------------
+#define AEX_SCRIPT_BEGIN		switch (mScriptLine) { case 0:
+#define AEX_SCRIPT_END			} mScriptLine = AEX::ScriptComp::SCRIPT_FINISHED; return
+#define AEX_SCRIPT_YIELD(wait, line)	do { mScriptLine = line; wait; return; case line:; } while (0)
+
+#define AEX_WAIT_FRAME()			AEX_SCRIPT_YIELD(aexScripts->WaitFrame(this), __COUNTER__ + 1)
+#define AEX_WAIT_SECONDS(seconds)	AEX_SCRIPT_YIELD(aexScripts->WaitSeconds(this, seconds), __COUNTER__ + 1)
+#define AEX_WAIT_EVENT(type)		AEX_SCRIPT_YIELD(aexScripts->WaitEvent<type>(this), __COUNTER__ + 1)
+#define AEX_WAIT_COLLISION(collider)	AEX_SCRIPT_YIELD(aexScripts->WaitCollision(this, collider), __COUNTER__ + 1)
+
+namespace AEX
+{
+	// A LogicComp that isn't updated by Logic: it runs when it is initialized
+	// and then only when what it waits for happens. Disabled, it is resumed
+	// when enabled again.
+	class ScriptComp : public LogicComp
+	{
+		AEX_RTTI_DECL(ScriptComp, LogicComp);
+	public:
+		static const s32 SCRIPT_FINISHED = -1;
+
+		ScriptComp();
+		void Initialize();					// starts the script
+		void Shutdown();					// stops it, the wait is cancelled
+		virtual void SetEnabled(bool enabled);
+
+		void Restart();						// from AEX_SCRIPT_BEGIN, next frame
+		bool IsFinished() const { return mScriptLine == SCRIPT_FINISHED; }
+		bool IsWaiting() const { return mWaitList != NULL || mTimer != INVALID_TIMER; }
+
+		// the collision that ended the last AEX_WAIT_COLLISION (CEVENT_BEGIN)
+		const CollisionEvent & GetLastCollision() const { return mLastCollision; }
+
+	protected:
+		virtual void Run() = 0;				// the script
+		s32 mScriptLine;					// resume point, see AEX_SCRIPT_BEGIN
+
+	private:
+		friend class ScriptScheduler;
+		void Resume();						// runs until the next wait
+
+		void *			mWaitList;			// scheduler list it waits in, NULL if it doesn't
+		Collider *		mWaitCollider;		// AEX_WAIT_COLLISION, the key of its list
+		TimerHandle		mTimer;				// AEX_WAIT_SECONDS
+		bool			mbPaused;			// resumed while disabled
+		CollisionEvent	mLastCollision;
+	};
+
+	// Owns the waiting scripts: the frame waits in a list resumed in Update
+	// (called by Logic::Update), the time waits are aexTimers timers and the
+	// event/collision waits are in lists per type/collider, resumed by the
+	// event bus dispatch.
+	class ScriptScheduler : public ISystem
+	{
+		AEX_RTTI_DECL(ScriptScheduler, ISystem);
+		AEX_SINGLETON(ScriptScheduler);
+
+	public:
+		virtual ~ScriptScheduler();
+
+		virtual bool Initialize();
+		virtual void Update();				// the frame waits
+		void Shutdown();					// drops the waits (but the timers) and the bus subscriptions
+
+		// Waits, called by the AEX_WAIT_* macros
+		void WaitFrame(ScriptComp * script);
+		void WaitSeconds(ScriptComp * script, f64 seconds);
+		template <typename T> void WaitEvent(ScriptComp * script);
+		void WaitCollision(ScriptComp * script, Collider * collider);
+
+		// the last T of the dispatch that resumed the AEX_WAIT_EVENT(T)
+		template <typename T> const T & GetLastEvent();
+
+	private:
+		friend class ScriptComp;
+
+		struct Waiter
+		{
+			ScriptComp *	mScript;		// NULL once cancelled while being resumed
+		};
+		typedef std::vector<Waiter> WaiterList;
+
+		struct EventWaiters
+		{
+			virtual ~EventWaiters() {}
+			u32			mSubscription;
+			WaiterList	mWaiters;
+		};
+		template <typename T> struct TypedEventWaiters : public EventWaiters
+		{
+			T mLast;
+		};
+		template <typename T> static const void * TypeKey() { static const char key = 0; return &key; }
+		template <typename T> TypedEventWaiters<T> * GetEventWaiters();
+
+		void Wait(ScriptComp * script, WaiterList & list);
+		void Cancel(ScriptComp * script);				// out of its list, or its timer
+		void ResumeAll(WaiterList & waiters);			// empties the list first
+		void ResetWaits(WaiterList & waiters);			// clears it, its scripts don't wait anymore
+		void OnCollisions(const CollisionEvent * events, u32 count);
+
+		WaiterList								mNextFrame;
+		WaiterList								mResuming;		// taken out of a list, being resumed
+		WaiterList *							mResumingList;	// that list, kept even if it empties
+
+		std::map<const void *, EventWaiters *>	mEventWaiters;
+		std::map<Collider *, WaiterList>		mCollisionWaiters;
+		u32										mCollisionSubscription;
+	};
+}
+
+#define aexScripts (AEX::ScriptScheduler::Instance())
+
+// ----------------------------------------------------------------------------
+// Template implementation
+namespace AEX
+{
+	template <typename T>
+	ScriptScheduler::TypedEventWaiters<T> * ScriptScheduler::GetEventWaiters()
+	{
+		auto it = mEventWaiters.find(TypeKey<T>());
+		if (it != mEventWaiters.end())
+			return static_cast<TypedEventWaiters<T>*>(it->second);
+
+		// the first wait for T subscribes to it, for good
+		TypedEventWaiters<T> * waiters = new TypedEventWaiters<T>;
+		waiters->mSubscription = aexEvents->Subscribe<T>([this, waiters](const T * events, u32 count)
+		{
+			waiters->mLast = events[count - 1];
+			ResumeAll(waiters->mWaiters);
+		});
+		mEventWaiters[TypeKey<T>()] = waiters;
+		return waiters;
+	}
+
+	template <typename T>
+	void ScriptScheduler::WaitEvent(ScriptComp * script)
+	{
+		Wait(script, GetEventWaiters<T>()->mWaiters);
+	}
+
+	template <typename T>
+	const T & ScriptScheduler::GetLastEvent()
+	{
+		return GetEventWaiters<T>()->mLast;
+	}
+}
\ No newline at end of file
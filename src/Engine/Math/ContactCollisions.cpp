@@ -10,6 +10,7 @@
 // ----------------------------------------------------------------------------
 #include "Collisions.h"
 #include "ContactCollisions.h"
+#include "..\Core\AEXFrameMemory.h"
 #include <cfloat>	// FLT_MAX
 // ---------------------------------------------------------------------------
 
@@ -18,10 +19,38 @@
 namespace AEX
 {
 	// ------------------------------------- Function prototypes --------------------------------------------
-	void GetMinAndMaxProj(std::vector<AEVec2> & polVertices, AEVec2 & normal, f32 & min, f32 & max);
-	bool SAT(std::vector<AEVec2> & pol1Vertices, std::vector<AEVec2> & pol2Vertices, AEVec2 & vertexMin, AEVec2 & vertexMax,
+	void GetMinAndMaxProj(FrameVector<AEVec2> & polVertices, AEVec2 & normal, f32 & min, f32 & max);
+	bool SAT(FrameVector<AEVec2> & pol1Vertices, FrameVector<AEVec2> & pol2Vertices, AEVec2 & vertexMin, AEVec2 & vertexMax,
 			 Transform * tr1, Transform * tr2, Contact * pResult);
 
+	// Same test as StaticPointToOrientedRect, with the axes of the box already computed
+	static bool PointInOrientedRect(const AEVec2 & point, const Transform & obb, const AEVec2 * axes)
+	{
+		AEVec2 dist = point - obb.mTranslation;
+		return fabsf(dist * axes[0]) <= obb.mScale.x / 2 && fabsf(dist * axes[1]) <= obb.mScale.y / 2;
+	}
+
+	/**************************************************************************/
+	/*!
+	  \fn    
+		GetOrientedRectAxes
+
+	  \brief 
+		Computes the local x and y axes of an oriented rectangle.
+
+	  \param angleRad
+		The orientation of the rectangle, in radians.
+
+	  \param axes
+		The output, axes[0] is the x axis and axes[1] the y axis.
+	*/
+	/**************************************************************************/
+	void GetOrientedRectAxes(f32 angleRad, AEVec2 * axes)
+	{
+		axes[0] = AEVec2(cosf(angleRad), sinf(angleRad));
+		axes[1] = AEVec2(-axes[0].y, axes[0].x);
+	}
+
 	/**************************************************************************/
 	/*!
 	  \fn    
@@ -175,22 +204,29 @@ namespace AEX
 	/**************************************************************************/
 	bool StaticOBBToStaticCircleEx(Transform * OBB, AEVec2 * Center, float Radius, Contact * pResult)
 	{
+		AEVec2 axes[2];
+		GetOrientedRectAxes(OBB->mOrientation, axes);
+		return StaticOBBToStaticCircleEx(OBB, axes, Center, Radius, pResult);
+	}
+	bool StaticOBBToStaticCircleEx(Transform * OBB, const AEVec2 * axes, AEVec2 * Center, float Radius, Contact * pResult)
+	{
+		// Center of the circle in the space of the OBB (rotation and translation only)
+		AEVec2 dist = *Center - OBB->mTranslation;
+		AEVec2 localCenter(dist * axes[0], dist * axes[1]);
+
 		// Check if the OBB and the circle are intersecting
-		if (OrientedRectToStaticCirlce(&OBB->mTranslation, OBB->mScale.x, OBB->mScale.y, OBB->mOrientation, Center, Radius))
+		if (StaticRectToStaticCirlce(&AEVec2(0, 0), OBB->mScale.x, OBB->mScale.y, &localCenter, Radius))
 		{
 			// Check if pResult is not NULL
 			if (pResult)
 			{
-				// Get the transform and inverse matrix from the OBB
-				AEMtx33 transfMtx = AEMtx33::Translate(OBB->mTranslation.x, OBB->mTranslation.y) * AEMtx33::RotRad(OBB->mOrientation);
-				AEMtx33 inverseMtx = AEMtx33::RotRad(-OBB->mOrientation) * AEMtx33::Translate(-OBB->mTranslation.x, -OBB->mTranslation.y);
-
 				// Get the parameters from AABB vs circle
-				StaticRectToStaticCircleEx(&AEVec2(0, 0), OBB->mScale.x, OBB->mScale.y, &(inverseMtx * *Center), Radius, pResult);
+				StaticRectToStaticCircleEx(&AEVec2(0, 0), OBB->mScale.x, OBB->mScale.y, &localCenter, Radius, pResult);
 
-				// Get the normal and point of intersection by multiplying by the normal matrix
-				pResult->mNormal = transfMtx.MultVec(pResult->mNormal);
-				pResult->mPi = transfMtx * pResult->mPi;
+				// Back to world space
+				AEVec2 normal = pResult->mNormal, pi = pResult->mPi;
+				pResult->mNormal = axes[0] * normal.x + axes[1] * normal.y;
+				pResult->mPi = OBB->mTranslation + axes[0] * pi.x + axes[1] * pi.y;
 			}
 			return true; // There is collision; return true
 		}
@@ -294,18 +330,19 @@ namespace AEX
 	*/
 	/**************************************************************************/
 	bool OrientedRectToOrientedRectEx(Transform * OBB1, Transform * OBB2, Contact * pResult)
+	{
+		AEVec2 axes1[2], axes2[2];
+		GetOrientedRectAxes(OBB1->mOrientation, axes1);
+		GetOrientedRectAxes(OBB2->mOrientation, axes2);
+		return OrientedRectToOrientedRectEx(OBB1, axes1, OBB2, axes2, pResult);
+	}
+	bool OrientedRectToOrientedRectEx(Transform * OBB1, const AEVec2 * axes1, Transform * OBB2, const AEVec2 * axes2, Contact * pResult)
 	{
 		// Compute the distance between both OBBs
 		AEVec2 dist = OBB2->mTranslation - OBB1->mTranslation;
 	
-		// Get the normals from each OBB
-		AEVec2 normals[4];
-		// OBB 1
-		normals[0].FromAngle(OBB1->mOrientation);
-		normals[1].FromAngle(OBB1->mOrientation + PI/2);
-		// OBB 2
-		normals[2].FromAngle(OBB2->mOrientation);
-		normals[3].FromAngle(OBB2->mOrientation + PI/2);
+		// The normals of each OBB are its axes
+		AEVec2 normals[4] = { axes1[0], axes1[1], axes2[0], axes2[1] };
 
 		// Get the half extents from each OBB
 		AEVec2 halfExtents[4];
@@ -363,7 +400,7 @@ namespace AEX
 		for (unsigned i = 0; i < AABB_VERTICES; i++)
 		{
 			// Check if pResult is not NULL amd if the corners from the second AABB are intersecting with the first AABB
-			if (pResult && StaticPointToOrientedRect(&AABB2Corners[i], &OBB1->mTranslation, OBB1->mScale.x, OBB1->mScale.y, OBB1->mOrientation))
+			if (pResult && PointInOrientedRect(AABB2Corners[i], *OBB1, axes1))
 			{
 				pResult->mPi = AABB2Corners[i];
 				return true; // There is collision; return true
@@ -373,12 +410,25 @@ namespace AEX
 		for (unsigned i = 0; i < AABB_VERTICES; i++)
 		{
 			// Check if pResult is not NULL amd if the corners from the first AABB are intersecting with the second AABB
-			if (pResult && StaticPointToOrientedRect(&AABB1Corners[i], &OBB2->mTranslation, OBB2->mScale.x, OBB2->mScale.y, OBB2->mOrientation))
+			if (pResult && PointInOrientedRect(AABB1Corners[i], *OBB2, axes2))
 			{
 				pResult->mPi = AABB1Corners[i];
 				return true; // There is collision; return true
 			}
 		}
+
+		// No separating axis but no corner inside the other box (edge-edge), 
+		// there is still a collision. The contact point is the corner of the
+		// second OBB deepest along the normal (the first one on a tie).
+		if (pResult)
+		{
+			unsigned deepest = 0;
+			for (unsigned i = 1; i < AABB_VERTICES; i++)
+				if (AABB2Corners[i] * pResult->mNormal < AABB2Corners[deepest] * pResult->mNormal)
+					deepest = i;
+			pResult->mPi = AABB2Corners[deepest];
+		}
+		return true;
 	}
 
 
@@ -412,9 +462,12 @@ namespace AEX
 	/**************************************************************************/
 	bool PolygonToPolygon(Polygon2D * p1, Transform * tr1, Polygon2D * p2, Transform * tr2, Contact * pResult)
 	{
-		// Get the polygon
-		std::vector<AEVec2> pol1Vertices = p1->GetTransformedVertices(tr1->GetMatrix());
-		std::vector<AEVec2> pol2Vertices = p2->GetTransformedVertices(tr2->GetMatrix());
+		// Get the polygon (frame memory, no heap allocation per test)
+		FrameVector<AEVec2> pol1Vertices(p1->GetSize()), pol2Vertices(p2->GetSize());
+		if (pol1Vertices.empty() || pol2Vertices.empty())
+			return false;
+		p1->GetTransformedVertices(tr1->GetMatrix(), &pol1Vertices[0]);
+		p2->GetTransformedVertices(tr2->GetMatrix(), &pol2Vertices[0]);
 
 		// Check if pResult is not NULL
 		if (pResult)
@@ -466,7 +519,7 @@ namespace AEX
 		The maximum value from the proyected vertices.
 	*/
 	/**************************************************************************/
-	void GetMinAndMaxProj(std::vector<AEVec2> & polVertices, AEVec2 & normal, f32 & min, f32 & max)
+	void GetMinAndMaxProj(FrameVector<AEVec2> & polVertices, AEVec2 & normal, f32 & min, f32 & max)
 	{
 		// Create a for loop to access all the vertices from the polygon
 		for (u32 i = 0; i < polVertices.size(); i++)
@@ -515,7 +568,7 @@ namespace AEX
 		The checkup if the polygons are colliding or not on the projected axis.
 	*/
 	/**************************************************************************/
-	bool SAT(std::vector<AEVec2> & pol1Vertices, std::vector<AEVec2> & pol2Vertices, AEVec2 & vertexMin, AEVec2 & vertexMax,
+	bool SAT(FrameVector<AEVec2> & pol1Vertices, FrameVector<AEVec2> & pol2Vertices, AEVec2 & vertexMin, AEVec2 & vertexMax,
 			 Transform * tr1, Transform * tr2, Contact * pResult)
 	{
 		// Compute the edge vector
@@ -546,4 +599,150 @@ namespace AEX
 
 		return true; // Continue checking!
 	}
+
+	// Deepest separation of polygon 2 along the normals of polygon 1 (> 0 means
+	// there is a separating axis). outEdge is the edge of polygon 1 and outVertex
+	// the vertex of polygon 2 that is the furthest into it.
+	static f32 MaxSeparation(const AEVec2 * vertices1, const AEVec2 * normals1, u32 count1,
+							 const AEVec2 * vertices2, u32 count2, u32 & outEdge, u32 & outVertex)
+	{
+		f32 maxSeparation = -FLT_MAX;
+		for (u32 i = 0; i < count1; ++i)
+		{
+			// closest vertex of 2 to the edge plane
+			f32 minDist = FLT_MAX;
+			u32 minVertex = 0;
+			for (u32 j = 0; j < count2; ++j)
+			{
+				f32 dist = normals1[i] * (vertices2[j] - vertices1[i]);
+				if (dist < minDist)
+				{
+					minDist = dist;
+					minVertex = j;
+				}
+			}
+
+			if (minDist > maxSeparation)
+			{
+				maxSeparation = minDist;
+				outEdge = i;
+				outVertex = minVertex;
+			}
+		}
+		return maxSeparation;
+	}
+
+	/**************************************************************************/
+	/*!
+	  \fn    
+		ConvexPolygonsEx
+
+	  \brief 
+		Checks for the collision between two convex polygons with the 
+		Separating Axis Theorem, on the edge normals of both polygons. The axis
+		of minimum penetration gives the contact normal.
+	*/
+	/**************************************************************************/
+	bool ConvexPolygonsEx(const AEVec2 * vertices1, const AEVec2 * normals1, u32 count1,
+						  const AEVec2 * vertices2, const AEVec2 * normals2, u32 count2, Contact * pResult)
+	{
+		if (count1 < 3 || count2 < 3)
+			return false;
+
+		u32 edge1 = 0, vertex2 = 0;
+		f32 separation1 = MaxSeparation(vertices1, normals1, count1, vertices2, count2, edge1, vertex2);
+		if (separation1 > 0.0f)
+			return false; // There is a separating axis on polygon 1
+
+		u32 edge2 = 0, vertex1 = 0;
+		f32 separation2 = MaxSeparation(vertices2, normals2, count2, vertices1, count1, edge2, vertex1);
+		if (separation2 > 0.0f)
+			return false; // There is a separating axis on polygon 2
+
+		if (pResult)
+		{
+			// the least penetrating axis (prefer polygon 1 on ties, keeps it stable)
+			if (separation1 >= separation2)
+			{
+				pResult->mNormal = normals1[edge1];
+				pResult->mPenetration = -separation1;
+				pResult->mPi = vertices2[vertex2];
+			}
+			else
+			{
+				pResult->mNormal = -normals2[edge2];
+				pResult->mPenetration = -separation2;
+				pResult->mPi = vertices1[vertex1];
+			}
+		}
+		return true;
+	}
+
+	/**************************************************************************/
+	/*!
+	  \fn    
+		ConvexPolygonToCircleEx
+
+	  \brief 
+		Checks for the collision between a convex polygon and a circle. Finds 
+		the edge closest to the center, then resolves against the edge or one
+		of its vertices depending on where the center projects.
+	*/
+	/**************************************************************************/
+	bool ConvexPolygonToCircleEx(const AEVec2 * vertices, const AEVec2 * normals, u32 count,
+								 const AEVec2 & center, float radius, Contact * pResult)
+	{
+		if (count < 3)
+			return false;
+
+		// edge with the maximum separation from the center
+		f32 separation = -FLT_MAX;
+		u32 edge = 0;
+		for (u32 i = 0; i < count; ++i)
+		{
+			f32 dist = normals[i] * (center - vertices[i]);
+			if (dist > radius)
+				return false; // There is a separating axis
+			if (dist > separation)
+			{
+				separation = dist;
+				edge = i;
+			}
+		}
+
+		AEVec2 normal = normals[edge];
+		f32 penetration = radius - separation;
+
+		// center outside: closest feature may be a vertex of the edge
+		if (separation > 0.0f)
+		{
+			const AEVec2 & v1 = vertices[edge];
+			const AEVec2 & v2 = vertices[(edge + 1) % count];
+			const AEVec2 * corner = NULL;
+			if ((center - v1) * (v2 - v1) <= 0.0f)
+				corner = &v1;
+			else if ((center - v2) * (v1 - v2) <= 0.0f)
+				corner = &v2;
+
+			if (corner)
+			{
+				AEVec2 toCenter = center - *corner;
+				f32 distSq = toCenter * toCenter;
+				if (distSq > radius * radius)
+					return false;
+				f32 dist = sqrtf(distSq);
+				if (dist > 0.0f)
+					normal = toCenter * (1.0f / dist);
+				penetration = radius - dist;
+			}
+		}
+
+		if (pResult)
+		{
+			pResult->mNormal = normal;
+			pResult->mPenetration = penetration;
+			pResult->mPi = center - normal * radius;
+		}
+		return true;
+	}
 }
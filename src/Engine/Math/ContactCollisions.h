@@ -73,6 +73,8 @@ namespace AEX
 	//  \return	true if the shapes overlap, false otherwise
 	// ---------------------------------------------------------------------------
 	bool StaticOBBToStaticCircleEx(Transform * OBB, AEVec2 * Center, float Radius, Contact * pResult);
+	// Same, with the axes of the OBB already computed (see GetOrientedRectAxes)
+	bool StaticOBBToStaticCircleEx(Transform * OBB, const AEVec2 * axes, AEVec2 * Center, float Radius, Contact * pResult);
 	
 	//! ---------------------------------------------------------------------------
 	// \fn		StaticRectToStaticRectEx
@@ -106,6 +108,15 @@ namespace AEX
 	//  \return	true if the shapes overlap, false otherwise
 	// ---------------------------------------------------------------------------
 	bool OrientedRectToOrientedRectEx(Transform * OBB1, Transform	 * OBB2, Contact * pResult);
+	// Same, with the axes of the OBBs already computed (see GetOrientedRectAxes)
+	bool OrientedRectToOrientedRectEx(Transform * OBB1, const AEVec2 * axes1, Transform * OBB2, const AEVec2 * axes2, Contact * pResult);
+
+	//! ---------------------------------------------------------------------------
+	// \fn		GetOrientedRectAxes
+	// \brief	Local x (axes[0]) and y (axes[1]) axes of a box rotated angleRad.
+	//			TransformComp caches them, see TransformComp::GetAxisX.
+	// ---------------------------------------------------------------------------
+	void GetOrientedRectAxes(f32 angleRad, AEVec2 * axes);
 
 	//! ---------------------------------------------------------------------------
 	// \fn		PolygonToPolygon
@@ -119,6 +130,34 @@ namespace AEX
 	//  \return	true if the shapes overlap, false otherwise
 	// ---------------------------------------------------------------------------
 	bool PolygonToPolygon(Polygon2D * p1, Transform * tr1, Polygon2D * p2, Transform * tr2, Contact * pResult);
+
+	//! ---------------------------------------------------------------------------
+	// \fn		ConvexPolygonsEx
+	// \brief	SAT between two convex polygons given in world space, with the 
+	//			outward normal of each edge (normals[i] is the normal of the edge
+	//			vertices[i] -> vertices[i + 1]). Doesn't allocate.
+	//
+	// \details	
+	//			- Normal goes from polygon 1 to polygon 2.
+	//			- The point of intersection is the deepest vertex.
+	// 
+	//  \return	true if the shapes overlap, false otherwise
+	// ---------------------------------------------------------------------------
+	bool ConvexPolygonsEx(const AEVec2 * vertices1, const AEVec2 * normals1, u32 count1,
+						  const AEVec2 * vertices2, const AEVec2 * normals2, u32 count2, Contact * pResult);
+
+	//! ---------------------------------------------------------------------------
+	// \fn		ConvexPolygonToCircleEx
+	// \brief	Same as above between a convex polygon and a circle.
+	//
+	// \details	
+	//			- Normal goes from the polygon to the circle.
+	//			- Handles the center of the circle inside the polygon.
+	// 
+	//  \return	true if the shapes overlap, false otherwise
+	// ---------------------------------------------------------------------------
+	bool ConvexPolygonToCircleEx(const AEVec2 * vertices, const AEVec2 * normals, u32 count,
+								 const AEVec2 & center, float radius, Contact * pResult);
 }
 
 
@@ -9,6 +9,7 @@
 //	Author:			Alejandro Balea Moreno, alejandro.balea (540002118)
 // ----------------------------------------------------------------------------
 #include "Polygon2D.h"
+#include "SimdMath.h"
 
 namespace AEX
 {
@@ -87,13 +88,19 @@ namespace AEX
 	/**************************************************************************/
 	AEVec2 & Polygon2D::operator[](u32 idx)
 	{
-		// Check id the size of mVertices is lower than index. If that's so, abort
-		if (idx > mVertices.size())
+		// Check if the index is past the last vertex. If that's so, abort
+		if (idx >= mVertices.size())
 			std::abort();
 
 		// Return the indexed vertex
 		return mVertices[idx];
 	}
+	const AEVec2 & Polygon2D::operator[](u32 idx) const
+	{
+		if (idx >= mVertices.size())
+			std::abort();
+		return mVertices[idx];
+	}
 
 	/**************************************************************************/
 	/*!
@@ -170,6 +177,11 @@ namespace AEX
 		// return the computed vertex array
 		return vertexArray;
 	}
+	void Polygon2D::GetTransformedVertices(const AEMtx33 & mat_transform, AEVec2 * outVertices) const
+	{
+		if (!mVertices.empty())
+			Simd::TransformPoints(mat_transform, &mVertices[0], outVertices, mVertices.size());
+	}
 
 	/*! @PROVIDED
 	*	\brief	Draws the polygon with the provided color and transform.
@@ -52,6 +52,7 @@ namespace AEX
 		*			reference. If a erroneous index is passed. An error will be thrown.
 		*/
 		AEVec2 &	operator[](u32 idx);
+		const AEVec2 &	operator[](u32 idx) const;
 
 		/*!	@TODO
 		*	\brief	Removes all vertices in the polygon
@@ -77,6 +78,12 @@ namespace AEX
 		*/
 		std::vector<AEVec2> GetTransformedVertices(const AEMtx33 &mat_transform) const;
 
+		/*!
+		*	\brief	Same as above, written to outVertices (GetSize() elements) 
+		*			instead of allocating a new vector.
+		*/
+		void GetTransformedVertices(const AEMtx33 &mat_transform, AEVec2 * outVertices) const;
+
 		/*! @PROVIDED
 		*	\brief	Draws the polygon with the provided color and transform.
 		*/
@@ -10,6 +10,7 @@
 //	Author:			Alejandro Balea Moreno - alejandro.balea (540002118)
 // ----------------------------------------------------------------------------
 #include "Raycast.h"
+#include <cfloat>	// FLT_MAX
 
 namespace AEX
 {
@@ -123,13 +124,14 @@ namespace AEX
 		The point of intersection between the ray and the Line segment.
  
 	  \return
-		The time of intersection as a factor of dir.
+		The time of intersection as a factor of dir, FLT_MAX if it misses.
+		Needs outPi (RayCastLine doesn't compute the hit without it).
 	*/
 	/**************************************************************************/
 	f32 RayCastRect(const AEVec2 & origin, const AEVec2 & dir, const Transform & rect, AEVec2 * outPi)
 	{
-		// Set time as its maximum value (infinite)
-		f32 time = (f32)INFINITE;
+		// Set time as its maximum value (FLT_MAX if nothing is hit)
+		f32 time = FLT_MAX;
 
 		// Compute both half extents
 		AEVec2 halfExtentX, halfExtentY;
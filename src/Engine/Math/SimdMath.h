@@ -0,0 +1,282 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	SimdMath.h
+// Purpose:	Header only math for the hot paths. The AEVec2/AEMtx33/AEMtx44
+//			operators live in aexmath.dll, so every add, dot or multiply is a
+//			call the compiler can't inline. These types have the same layout
+//			(AsSimd/AsAEX reinterpret in place, no copies) and are inline,
+//			SSE where it pays off.
+//			Vec4 and Mtx44 are 16 byte aligned: pass them by reference (x86
+//			can't pass aligned parameters by value) and use Load/Store to go
+//			from/to the unaligned AEX types.
+// ----------------------------------------------------------------------------
+#ifndef AEX_SIMD_MATH_H_
+#define AEX_SIMD_MATH_H_
+
+#include <aexmath\AEXMath.h>
+#include <xmmintrin.h>	// SSE
+
+namespace AEX
+{
+	namespace Simd
+	{
+		// ------------------------------------------------------------------------
+		// \struct	Vec2
+		// \brief	Same layout as AEVec2.
+		struct Vec2
+		{
+			f32 x, y;
+
+			Vec2() {}
+			Vec2(f32 xx, f32 yy) : x(xx), y(yy) {}
+
+			Vec2 operator+(const Vec2 & rhs) const	{ return Vec2(x + rhs.x, y + rhs.y); }
+			Vec2 operator-(const Vec2 & rhs) const	{ return Vec2(x - rhs.x, y - rhs.y); }
+			Vec2 operator*(f32 s) const				{ return Vec2(x * s, y * s); }
+			Vec2 operator-() const					{ return Vec2(-x, -y); }
+			Vec2 & operator+=(const Vec2 & rhs)		{ x += rhs.x; y += rhs.y; return *this; }
+			Vec2 & operator-=(const Vec2 & rhs)		{ x -= rhs.x; y -= rhs.y; return *this; }
+			Vec2 & operator*=(f32 s)				{ x *= s; y *= s; return *this; }
+
+			// dot product, like AEVec2
+			f32 operator*(const Vec2 & rhs) const	{ return x * rhs.x + y * rhs.y; }
+			f32 Dot(const Vec2 & rhs) const			{ return x * rhs.x + y * rhs.y; }
+			f32 Cross(const Vec2 & rhs) const		{ return x * rhs.y - y * rhs.x; }
+			f32 LengthSq() const					{ return x * x + y * y; }
+			f32 Length() const						{ return sqrtf(x * x + y * y); }
+			Vec2 Perp() const						{ return Vec2(-y, x); }
+		};
+
+		// ------------------------------------------------------------------------
+		// \struct	Vec4
+		// \brief	4 floats in an SSE register (AEVec4 layout in memory).
+		struct alignas(16) Vec4
+		{
+			__m128 v;
+
+			Vec4() {}
+			Vec4(__m128 m) : v(m) {}
+			Vec4(f32 x, f32 y, f32 z, f32 w) : v(_mm_setr_ps(x, y, z, w)) {}
+			explicit Vec4(f32 s) : v(_mm_set1_ps(s)) {}
+
+			Vec4 operator+(const Vec4 & rhs) const	{ return _mm_add_ps(v, rhs.v); }
+			Vec4 operator-(const Vec4 & rhs) const	{ return _mm_sub_ps(v, rhs.v); }
+			Vec4 operator*(const Vec4 & rhs) const	{ return _mm_mul_ps(v, rhs.v); }	// per component
+			Vec4 operator*(f32 s) const				{ return _mm_mul_ps(v, _mm_set1_ps(s)); }
+			Vec4 & operator+=(const Vec4 & rhs)		{ v = _mm_add_ps(v, rhs.v); return *this; }
+			Vec4 & operator-=(const Vec4 & rhs)		{ v = _mm_sub_ps(v, rhs.v); return *this; }
+
+			f32 X() const { return _mm_cvtss_f32(v); }
+			f32 Dot(const Vec4 & rhs) const
+			{
+				__m128 m = _mm_mul_ps(v, rhs.v);
+				m = _mm_add_ps(m, _mm_movehl_ps(m, m));								// x+z, y+w
+				m = _mm_add_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));	// x+z+y+w
+				return _mm_cvtss_f32(m);
+			}
+
+			static Vec4 Load(const f32 * p)		{ return _mm_loadu_ps(p); }
+			void Store(f32 * p) const			{ _mm_storeu_ps(p, v); }
+			static Vec4 Min(const Vec4 & a, const Vec4 & b) { return _mm_min_ps(a.v, b.v); }
+			static Vec4 Max(const Vec4 & a, const Vec4 & b) { return _mm_max_ps(a.v, b.v); }
+		};
+
+		// ------------------------------------------------------------------------
+		// \struct	Mtx33
+		// \brief	Same layout as AEMtx33 (row major), for the 2D transforms.
+		//			Scalar: 9 floats don't fit the registers, the batch helpers
+		//			(TransformPoints) are the vectorized path.
+		struct Mtx33
+		{
+			f32 m[3][3];
+
+			Vec2 MultPoint(const Vec2 & p) const
+			{
+				return Vec2(m[0][0] * p.x + m[0][1] * p.y + m[0][2], m[1][0] * p.x + m[1][1] * p.y + m[1][2]);
+			}
+			Vec2 MultDir(const Vec2 & d) const
+			{
+				return Vec2(m[0][0] * d.x + m[0][1] * d.y, m[1][0] * d.x + m[1][1] * d.y);
+			}
+			Mtx33 operator*(const Mtx33 & rhs) const
+			{
+				Mtx33 r;
+				for (u32 i = 0; i < 3; ++i)
+					for (u32 j = 0; j < 3; ++j)
+						r.m[i][j] = m[i][0] * rhs.m[0][j] + m[i][1] * rhs.m[1][j] + m[i][2] * rhs.m[2][j];
+				return r;
+			}
+
+			// T * R * S, same as Transform::GetMatrix (with the sin/cos already computed)
+			static Mtx33 FromTransform(const Vec2 & pos, const Vec2 & scale, f32 sin, f32 cos)
+			{
+				Mtx33 r;
+				r.m[0][0] = cos * scale.x;	r.m[0][1] = -sin * scale.y;	r.m[0][2] = pos.x;
+				r.m[1][0] = sin * scale.x;	r.m[1][1] = cos * scale.y;	r.m[1][2] = pos.y;
+				r.m[2][0] = 0.0f;			r.m[2][1] = 0.0f;			r.m[2][2] = 1.0f;
+				return r;
+			}
+			// S^-1 * R^-1 * T^-1, same as Transform::GetInvMatrix
+			static Mtx33 FromInvTransform(const Vec2 & pos, const Vec2 & scale, f32 sin, f32 cos)
+			{
+				Mtx33 r;
+				f32 isx = 1.0f / scale.x, isy = 1.0f / scale.y;
+				r.m[0][0] = cos * isx;	r.m[0][1] = sin * isx;	r.m[0][2] = -(cos * pos.x + sin * pos.y) * isx;
+				r.m[1][0] = -sin * isy;	r.m[1][1] = cos * isy;	r.m[1][2] = (sin * pos.x - cos * pos.y) * isy;
+				r.m[2][0] = 0.0f;		r.m[2][1] = 0.0f;		r.m[2][2] = 1.0f;
+				return r;
+			}
+		};
+
+		// ------------------------------------------------------------------------
+		// \struct	Mtx44
+		// \brief	One SSE register per row (AEMtx44 is row major too).
+		struct alignas(16) Mtx44
+		{
+			__m128 r[4];
+
+			static Mtx44 Load(const f32 * v)
+			{
+				Mtx44 m;
+				for (u32 i = 0; i < 4; ++i)
+					m.r[i] = _mm_loadu_ps(v + i * 4);
+				return m;
+			}
+			void Store(f32 * v) const
+			{
+				for (u32 i = 0; i < 4; ++i)
+					_mm_storeu_ps(v + i * 4, r[i]);
+			}
+
+			// row i of the result = sum of the rows of rhs weighted by row i of this
+			Mtx44 operator*(const Mtx44 & rhs) const
+			{
+				Mtx44 res;
+				for (u32 i = 0; i < 4; ++i)
+				{
+					__m128 row = r[i];
+					__m128 sum = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), rhs.r[0]);
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), rhs.r[1]));
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), rhs.r[2]));
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3)), rhs.r[3]));
+					res.r[i] = sum;
+				}
+				return res;
+			}
+
+			// column vector, result = this * v
+			Vec4 operator*(const Vec4 & v) const
+			{
+				__m128 x = _mm_mul_ps(r[0], v.v), y = _mm_mul_ps(r[1], v.v);
+				__m128 z = _mm_mul_ps(r[2], v.v), w = _mm_mul_ps(r[3], v.v);
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+				return _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, w));
+			}
+		};
+
+		// ------------------------------------------------------------------------
+		// In place conversions (no copy, the layouts are the same)
+		inline Vec2 &			AsSimd(AEVec2 & v)				{ return reinterpret_cast<Vec2&>(v); }
+		inline const Vec2 &		AsSimd(const AEVec2 & v)		{ return reinterpret_cast<const Vec2&>(v); }
+		inline Mtx33 &			AsSimd(AEMtx33 & m)				{ return reinterpret_cast<Mtx33&>(m); }
+		inline const Mtx33 &	AsSimd(const AEMtx33 & m)		{ return reinterpret_cast<const Mtx33&>(m); }
+		inline AEVec2 &			AsAEX(Vec2 & v)					{ return reinterpret_cast<AEVec2&>(v); }
+		inline const AEVec2 &	AsAEX(const Vec2 & v)			{ return reinterpret_cast<const AEVec2&>(v); }
+		inline AEMtx33 &		AsAEX(Mtx33 & m)				{ return reinterpret_cast<AEMtx33&>(m); }
+		inline const AEMtx33 &	AsAEX(const Mtx33 & m)			{ return reinterpret_cast<const AEMtx33&>(m); }
+
+		// the aligned ones are loaded (the AEX types may not be aligned)
+		inline Vec4		Load(const AEVec4 & v)				{ return Vec4::Load(v.v); }
+		inline void		Store(const Vec4 & v, AEVec4 & out)	{ v.Store(out.v); }
+		inline Mtx44	Load(const AEMtx44 & m)				{ return Mtx44::Load(m.v); }
+		inline void		Store(const Mtx44 & m, AEMtx44 & out)	{ m.Store(out.v); }
+
+		static_assert(sizeof(Vec2) == sizeof(AEVec2), "Simd::Vec2 must match AEVec2");
+		static_assert(sizeof(Mtx33) == sizeof(AEMtx33), "Simd::Mtx33 must match AEMtx33");
+		static_assert(sizeof(Vec4) == sizeof(AEVec4), "Simd::Vec4 must match AEVec4");
+		static_assert(sizeof(Mtx44) == sizeof(AEMtx44), "Simd::Mtx44 must match AEMtx44");
+
+		//! -----------------------------------------------------------------------
+		// \fn		SinCos
+		// \brief	Sine and cosine of an angle in radians, with one range
+		//			reduction and two minimax polynomials (error ~1e-7 in
+		//			[-PI, PI], grows with |angle|). Not bitwise equal to
+		//			sinf/cosf, keep those where the results are compared.
+		// ------------------------------------------------------------------------
+		inline void SinCos(f32 angle, f32 * outSin, f32 * outCos)
+		{
+			// to [-PI, PI]
+			f32 quotient = angle * 0.159154943f;	// 1 / 2PI
+			quotient = static_cast<f32>(static_cast<s32>(quotient + (angle >= 0.0f ? 0.5f : -0.5f)));
+			f32 y = angle - 6.28318531f * quotient;
+
+			// to [-PI/2, PI/2], sin(y) is the same, cos(y) changes sign
+			f32 sign = 1.0f;
+			if (y > 1.57079633f)
+			{
+				y = 3.14159265f - y;
+				sign = -1.0f;
+			}
+			else if (y < -1.57079633f)
+			{
+				y = -3.14159265f - y;
+				sign = -1.0f;
+			}
+
+			f32 y2 = y * y;
+			*outSin = (((((-2.3889859e-08f * y2 + 2.7525562e-06f) * y2 - 0.00019840874f) * y2 + 0.0083333310f) * y2 - 0.16666667f) * y2 + 1.0f) * y;
+			*outCos = sign * (((((-2.6051615e-07f * y2 + 2.4760495e-05f) * y2 - 0.0013888378f) * y2 + 0.041666638f) * y2 - 0.5f) * y2 + 1.0f);
+		}
+
+		//! -----------------------------------------------------------------------
+		// \fn		TransformPoints
+		// \brief	out[i] = mtx * in[i] (as points), two points per SSE
+		//			operation. in and out can be the same array.
+		// ------------------------------------------------------------------------
+		inline void TransformPoints(const Mtx33 & mtx, const Vec2 * in, Vec2 * out, u32 count)
+		{
+			const __m128 colX = _mm_setr_ps(mtx.m[0][0], mtx.m[1][0], mtx.m[0][0], mtx.m[1][0]);
+			const __m128 colY = _mm_setr_ps(mtx.m[0][1], mtx.m[1][1], mtx.m[0][1], mtx.m[1][1]);
+			const __m128 trans = _mm_setr_ps(mtx.m[0][2], mtx.m[1][2], mtx.m[0][2], mtx.m[1][2]);
+
+			u32 i = 0;
+			for (; i + 2 <= count; i += 2)
+			{
+				__m128 p = _mm_loadu_ps(&in[i].x);		// x0 y0 x1 y1
+				__m128 xs = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));
+				__m128 ys = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));
+				_mm_storeu_ps(&out[i].x, _mm_add_ps(_mm_add_ps(_mm_mul_ps(colX, xs), _mm_mul_ps(colY, ys)), trans));
+			}
+			for (; i < count; ++i)
+				out[i] = mtx.MultPoint(in[i]);
+		}
+		inline void TransformPoints(const AEMtx33 & mtx, const AEVec2 * in, AEVec2 * out, u32 count)
+		{
+			TransformPoints(AsSimd(mtx), reinterpret_cast<const Vec2*>(in), reinterpret_cast<Vec2*>(out), count);
+		}
+
+		//! -----------------------------------------------------------------------
+		// \fn		TransformDirections
+		// \brief	Same as TransformPoints, without the translation.
+		// ------------------------------------------------------------------------
+		inline void TransformDirections(const Mtx33 & mtx, const Vec2 * in, Vec2 * out, u32 count)
+		{
+			const __m128 colX = _mm_setr_ps(mtx.m[0][0], mtx.m[1][0], mtx.m[0][0], mtx.m[1][0]);
+			const __m128 colY = _mm_setr_ps(mtx.m[0][1], mtx.m[1][1], mtx.m[0][1], mtx.m[1][1]);
+
+			u32 i = 0;
+			for (; i + 2 <= count; i += 2)
+			{
+				__m128 p = _mm_loadu_ps(&in[i].x);
+				__m128 xs = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));
+				__m128 ys = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));
+				_mm_storeu_ps(&out[i].x, _mm_add_ps(_mm_mul_ps(colX, xs), _mm_mul_ps(colY, ys)));
+			}
+			for (; i < count; ++i)
+				out[i] = mtx.MultDir(in[i]);
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+#endif
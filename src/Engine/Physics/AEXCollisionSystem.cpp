@@ -11,10 +11,16 @@
 // ----------------------------------------------------------------------------
 #include "AEXCollisionSystem.h"
 #include "src\Engine\Components\AEXComponents.h"
+#include "../Math/Raycast.h"
+#include "../Platform/AEXTime.h"	// FRC::GetCPUTime
+#include "../Core/AEXEventBus.h"
+#include <algorithm>	// std::sort, std::lower_bound
+#include <cfloat>		// FLT_MAX
+#include <xmmintrin.h>	// SSE, batched raycasts
 
 namespace AEX
 {
-	void PushIfNotDuplicate(std::vector<Collider *> & vec, Collider * RB);
+	CollisionSystem::CollisionSystem() : ISystem() {}
 
 	// @PROVIDED
 	//!----------------------------------------------------------------------------
@@ -25,7 +31,43 @@ namespace AEX
 	bool CollisionSystem::Initialize()
 	{
 		// default
-		mCollisionIterations = 5;
+		mSolverSettings.mVelocityIterations = 8;
+		mSolverSettings.mPositionIterations = 3;
+		mSolverSettings.mRestitution = DFLT_RESTITUTION;
+		mSolverSettings.mRestitutionThreshold = 1.0f;
+		mSolverSettings.mBaumgarte = 0.2f;
+		mSolverSettings.mLinearSlop = 0.01f;
+		mSolverSettings.mMaxCorrection = 10.0f;
+		mSolverSettings.mbWarmStarting = true;
+		mWarmStartNormalTolerance = 0.95f;
+		mbAllowSleeping = true;
+		mTimeStep = 1.0f / 60.0f;
+		mSleepLinearTolerance = 0.05f;
+		mSleepAngularTolerance = 0.035f;
+		mTimeToSleep = 0.5f;
+		mActiveBodies = mSleepingBodies = 0;
+		mActiveIslands = mSleepingIslands = 0;
+		mbContinuousCollision = true;
+		mCCDMotionThreshold = 1.0f;
+		mCCDBodiesThisFrame = 0;
+		mTOIHitsThisFrame = 0;
+		mCollisionsThisFrame = 0;
+		mStepCount = 0;
+		mZeroVelocity = AEVec2(0.0f, 0.0f);
+		mPairsThisFrame = 0;
+		mNarrowPhaseGrain = 64;
+		mNextColliderID = 0;
+		mNextListenerID = 0;
+		mDynamicMaxWidth = 0.0f;
+		mbStaticDirty = mbQueryDynamicDirty = true;
+		ResetLayerMatrix();
+		ResetPhaseTimes();
+
+		// narrowphase workers
+		SetThreadCount(0);
+
+		// a frame can have several steps, each with an event per touching pair
+		aexEvents->SetCapacity<CollisionEvent>(COLLISION_EVENT_CAPACITY);
 
 		for (u32 i = 0; i < CSHAPE_INDEX_MAX; ++i)
 			mCollisionTests[i] = NULL;
@@ -36,6 +78,10 @@ namespace AEX
 		mCollisionTests[CSHAPE_CIRCLE | CSHAPE_AABB] = CollideAABBToCircle;
 		mCollisionTests[CSHAPE_OBB | CSHAPE_AABB] = CollideOBBs;
 		mCollisionTests[CSHAPE_CIRCLE | CSHAPE_OBB] = CollideOBBToCircle;
+		mCollisionTests[CSHAPE_POLYGON | CSHAPE_POLYGON] = CollidePolygons;
+		mCollisionTests[CSHAPE_POLYGON | CSHAPE_AABB] = CollidePolygons;
+		mCollisionTests[CSHAPE_POLYGON | CSHAPE_OBB] = CollidePolygons;
+		mCollisionTests[CSHAPE_POLYGON | CSHAPE_CIRCLE] = CollidePolygonToCircle;
 
 		return true;
 	}
@@ -57,19 +103,91 @@ namespace AEX
 	void CollisionSystem::Shutdown()
 	{
 		ClearBodies();
+		mWorkers.Shutdown();
+	}
+
+	// ----------------------------------------------------------------------------
+	// Layer matrix
+	void CollisionSystem::SetLayerCollision(u32 layer1, u32 layer2, bool collide)
+	{
+		if (layer1 >= COLLISION_LAYER_MAX || layer2 >= COLLISION_LAYER_MAX)
+			return;
+		if (collide)
+		{
+			mLayerMatrix[layer1] |= 1u << layer2;
+			mLayerMatrix[layer2] |= 1u << layer1;
+		}
+		else
+		{
+			mLayerMatrix[layer1] &= ~(1u << layer2);
+			mLayerMatrix[layer2] &= ~(1u << layer1);
+		}
+	}
+	bool CollisionSystem::GetLayerCollision(u32 layer1, u32 layer2) const
+	{
+		if (layer1 >= COLLISION_LAYER_MAX || layer2 >= COLLISION_LAYER_MAX)
+			return false;
+		return (mLayerMatrix[layer1] & (1u << layer2)) != 0;
+	}
+	void CollisionSystem::ResetPhaseTimes()
+	{
+		for (u32 i = 0; i < CPHASE_COUNT; ++i)
+			mPhaseTimes[i] = 0.0;
+	}
+
+	const char * GetCollisionPhaseName(u32 phase)
+	{
+		static const char * names[CPHASE_COUNT] =
+		{
+			"prepare", "continuous", "broadphase", "narrowphase",
+			"events", "manifolds", "islands", "solve"
+		};
+		return phase < CPHASE_COUNT ? names[phase] : "";
+	}
+
+	void CollisionSystem::ResetLayerMatrix()
+	{
+		for (u32 i = 0; i < COLLISION_LAYER_MAX; ++i)
+			mLayerMatrix[i] = 0xFFFFFFFF;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		SetThreadCount
+	// \brief	Number of JobSystem workers the physics splits its work on
+	//			(0 = all of them). The contacts are merged in pair key
+	//			order, so the simulation is the same for any thread count.
+	// ----------------------------------------------------------------------------
+	void CollisionSystem::SetThreadCount(u32 threadCount)
+	{
+		mWorkers.Initialize(threadCount);
+		mThreadContacts.resize(mWorkers.GetThreadCount());
 	}
 
 	// @PROVIDED
 	//!----------------------------------------------------------------------------
 	// \fn		AddRigidBody
 	// \brief	Adds the rigidbody to the appropriate container (based on is_dynamic). 
+	//			Colliders register themselves in Collider::Initialize, adding
+	//			a registered collider again does nothing.
 	// ----------------------------------------------------------------------------
-	void CollisionSystem::AddRigidBody(Collider* obj, bool Collider)
+	void CollisionSystem::AddRigidBody(Collider* obj, bool is_dynamic)
 	{
-		/*if (obj->mOwner->)
+		if (obj->mbRegistered)
+			return;
+		obj->mbRegistered = true;
+
+		// unique id, used to build deterministic pair keys
+		obj->mColliderID = mNextColliderID++;
+		obj->mbDynamic = is_dynamic;
+
+		if (is_dynamic)
 			mDynamicBodies.push_back(obj);
 		else
-			mStaticBodies.push_back(obj);*/
+		{
+			mStaticBodies.push_back(obj);
+			mbStaticDirty = true;
+		}
+		mbQueryDynamicDirty = true;
 	}
 	// @PROVIDED
 	//!----------------------------------------------------------------------------
@@ -78,8 +196,34 @@ namespace AEX
 	// ----------------------------------------------------------------------------
 	void CollisionSystem::RemoveRigidBody(Collider *obj)
 	{
-		mDynamicBodies.remove(obj);
-		mStaticBodies.remove(obj);
+		if (!obj->mbRegistered)
+			return;
+		obj->mbRegistered = false;
+
+		if (obj->mbDynamic)
+			mDynamicBodies.remove(obj);
+		else
+		{
+			mStaticBodies.remove(obj);
+			mbStaticDirty = true;
+		}
+		mbQueryDynamicDirty = true;
+
+		// forget its contacts
+		for (auto it = mManifolds.begin(); it != mManifolds.end();)
+		{
+			if (it->second.mBody1 == obj || it->second.mBody2 == obj)
+				it = mManifolds.erase(it);
+			else
+				++it;
+		}
+		for (auto it = mActivePairs.begin(); it != mActivePairs.end();)
+		{
+			if (it->second.mBody1 == obj || it->second.mBody2 == obj)
+				it = mActivePairs.erase(it);
+			else
+				++it;
+		}
 	}
 	// @PROVIDED
 	//!----------------------------------------------------------------------------
@@ -88,8 +232,23 @@ namespace AEX
 	// ----------------------------------------------------------------------------
 	void CollisionSystem::ClearBodies()
 	{
+		FOR_EACH(it, mDynamicBodies)
+			(*it)->mbRegistered = false;
+		FOR_EACH(it, mStaticBodies)
+			(*it)->mbRegistered = false;
 		mDynamicBodies.clear();
 		mStaticBodies.clear();
+		mStaticProxies.clear();
+		mStaticTree.clear();
+		mStaticVersions.clear();
+		mDynamicProxies.clear();
+		mbStaticDirty = mbQueryDynamicDirty = true;
+		mManifolds.clear();
+		mActivePairs.clear();
+		mEvents.clear();
+		mConstraints.clear();
+		mIslands.clear();
+		mAwakeIslands.clear();
 	}
 
 	// @PROVIDED
@@ -104,22 +263,26 @@ namespace AEX
 		return mCollisionTests[collision_index];
 	}
 
+	// NOTE: the collision tests run on the narrowphase workers. They must only
+	// read the cached component pointers (never GetOwner()->GetComp()).
 	bool CollideCircles(Collider* body1, Collider* body2, Contact * c)
 	{
-		AEVec2 pos1 = GetTransLocalByComp(body1).mTranslation;
-		AEVec2 pos2 = GetTransLocalByComp(body2).mTranslation;
+		Transform & tr1 = body1->mTransform->mLocal;
+		Transform & tr2 = body2->mTransform->mLocal;
 
-		return StaticCircleToStaticCircleEx(&pos1, GetTransLocalByComp(body1).mScale.x, &pos2, GetTransLocalByComp(body2).mScale.x, c);
+		return StaticCircleToStaticCircleEx(&tr1.mTranslation, tr1.mScale.x, &tr2.mTranslation, tr2.mScale.x, c);
 	}
 	bool CollideAABBs(Collider* body1, Collider* body2, Contact * c)
 	{
-		AEVec2 p1 = GetTransLocalByComp(body1).mTranslation, s1 = GetTransLocalByComp(body1).mScale,
-			   p2 = GetTransLocalByComp(body2).mTranslation, s2 = GetTransLocalByComp(body2).mScale;
-		return StaticRectToStaticRectEx(&p1, &s1, &p2, &s2, c);
+		Transform & tr1 = body1->mTransform->mLocal;
+		Transform & tr2 = body2->mTransform->mLocal;
+		return StaticRectToStaticRectEx(&tr1.mTranslation, &tr1.mScale, &tr2.mTranslation, &tr2.mScale, c);
 	}
 	bool CollideOBBs(Collider* body1, Collider* body2, Contact * c)
 	{
-		return OrientedRectToOrientedRectEx(&GetTransLocalByComp(body1), &GetTransLocalByComp(body2), c);
+		TransformComp * tr1 = body1->mTransform;
+		TransformComp * tr2 = body2->mTransform;
+		return OrientedRectToOrientedRectEx(&tr1->mLocal, tr1->GetAxes(), &tr2->mLocal, tr2->GetAxes(), c);
 	}
 	bool CollideAABBToCircle(Collider* body1, Collider* body2, Contact * c)
 	{
@@ -127,7 +290,9 @@ namespace AEX
 		Collider * rect		= body1->mCollisionShape == CSHAPE_AABB ? body1 : body2;
 		Collider * circle	= body1->mCollisionShape == CSHAPE_CIRCLE ? body1 : body2;
 
-		if (StaticRectToStaticCircleEx(&AEVec2(GetTransLocalByComp(rect).mTranslation), GetTransLocalByComp(rect).mScale.x, GetTransLocalByComp(rect).mScale.y, &AEVec2(GetTransLocalByComp(circle).mTranslation), GetTransLocalByComp(circle).mScale.x, c))
+		Transform & rectTr = rect->mTransform->mLocal;
+		Transform & circleTr = circle->mTransform->mLocal;
+		if (StaticRectToStaticCircleEx(&rectTr.mTranslation, rectTr.mScale.x, rectTr.mScale.y, &circleTr.mTranslation, circleTr.mScale.x, c))
 		{
 			if (circle == body1) // flip normal to match our convention
 				c->mNormal = -c->mNormal;
@@ -139,12 +304,38 @@ namespace AEX
 	{
 
 		// which is which
-		Transform obb = body1->mCollisionShape == CSHAPE_OBB
-			? Transform(GetTransLocalByComp(body1))
-			: Transform(GetTransLocalByComp(body2));
+		Collider * obb		= body1->mCollisionShape == CSHAPE_OBB ? body1 : body2;
+		Collider * circle	= body1->mCollisionShape == CSHAPE_CIRCLE ? body1 : body2;
+
+		TransformComp * obbTr = obb->mTransform;
+		Transform & circleTr = circle->mTransform->mLocal;
+		if (StaticOBBToStaticCircleEx(&obbTr->mLocal, obbTr->GetAxes(), &circleTr.mTranslation, circleTr.mScale.x, c))
+		{
+			if (circle == body1) // flip normal to match our convention
+				c->mNormal = -c->mNormal;
+			return true;
+		}
+		return false;
+	}
+
+	bool CollidePolygons(Collider* body1, Collider* body2, Contact * c)
+	{
+		AEVec2 box1[8], box2[8];
+		const AEVec2 * vtx1, * nrm1, * vtx2, * nrm2;
+		u32 count1 = GetColliderPolygon(body1, box1, box1 + 4, &vtx1, &nrm1);
+		u32 count2 = GetColliderPolygon(body2, box2, box2 + 4, &vtx2, &nrm2);
+		return ConvexPolygonsEx(vtx1, nrm1, count1, vtx2, nrm2, count2, c);
+	}
+	bool CollidePolygonToCircle(Collider* body1, Collider* body2, Contact * c)
+	{
+		// which is which
+		Collider * polygon	= body1->mCollisionShape == CSHAPE_POLYGON ? body1 : body2;
+		Collider * circle	= body1->mCollisionShape == CSHAPE_CIRCLE ? body1 : body2;
 
-		Collider * circle = body1->mCollisionShape == CSHAPE_CIRCLE ? body1 : body2;
-		if (StaticOBBToStaticCircleEx(&obb, &AEVec2(GetTransLocalByComp(circle).mTranslation), GetTransLocalByComp(circle).mScale.x, c))
+		const AEVec2 * vertices, * normals;
+		u32 vertexCount = GetColliderPolygon(polygon, NULL, NULL, &vertices, &normals);
+		const Transform & circleTr = circle->mTransform->mLocal;
+		if (ConvexPolygonToCircleEx(vertices, normals, vertexCount, circleTr.mTranslation, circleTr.mScale.x, c))
 		{
 			if (circle == body1) // flip normal to match our convention
 				c->mNormal = -c->mNormal;
@@ -153,6 +344,128 @@ namespace AEX
 		return false;
 	}
 
+	//!----------------------------------------------------------------------------
+	// \fn		GetColliderPolygon
+	// \brief	The polygons use their cached world vertices (up to date after 
+	//			ComputeColliderBounds), the boxes are built on the given arrays.
+	// ----------------------------------------------------------------------------
+	u32 GetColliderPolygon(Collider * body, AEVec2 * boxVertices, AEVec2 * boxNormals, const AEVec2 ** outVertices, const AEVec2 ** outNormals)
+	{
+		if (body->mCollisionShape == CSHAPE_POLYGON)
+		{
+			*outVertices = body->mWorldVertices.empty() ? NULL : &body->mWorldVertices[0];
+			*outNormals = body->mWorldNormals.empty() ? NULL : &body->mWorldNormals[0];
+			return body->mWorldVertices.size();
+		}
+
+		const Transform & tr = body->mTransform->mLocal;
+		const bool oriented = body->mCollisionShape == CSHAPE_OBB;
+		AEVec2 axisX = oriented ? body->mTransform->GetAxisX() : AEVec2(1.0f, 0.0f);
+		AEVec2 axisY = oriented ? body->mTransform->GetAxisY() : AEVec2(0.0f, 1.0f);
+		AEVec2 hx = axisX * (fabsf(tr.mScale.x) * 0.5f), hy = axisY * (fabsf(tr.mScale.y) * 0.5f);
+
+		// counter clockwise, normal i is the one of the edge i -> i + 1
+		boxVertices[0] = tr.mTranslation - hx - hy;
+		boxVertices[1] = tr.mTranslation + hx - hy;
+		boxVertices[2] = tr.mTranslation + hx + hy;
+		boxVertices[3] = tr.mTranslation - hx + hy;
+		boxNormals[0] = -axisY;
+		boxNormals[1] = axisX;
+		boxNormals[2] = axisY;
+		boxNormals[3] = -axisX;
+
+		*outVertices = boxVertices;
+		*outNormals = boxNormals;
+		return 4;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		ComputeColliderBounds
+	// \brief	World space AABB of the collider. Scale is the full size of the
+	//			boxes and the radius of the circles (same as the collision tests).
+	//			The collider needs a transform, synced (see CacheBodyComponents).
+	// ----------------------------------------------------------------------------
+	void ComputeColliderBounds(Collider * body, ColliderBounds * out)
+	{
+		const Transform & tr = body->mTransform->mLocal;
+		AEVec2 halfExtents;
+
+		switch (body->mCollisionShape)
+		{
+		case CSHAPE_CIRCLE:
+			halfExtents = AEVec2(tr.mScale.x, tr.mScale.x);
+			break;
+		case CSHAPE_OBB:
+		{
+			f32 c = fabsf(body->mTransform->GetCos()), s = fabsf(body->mTransform->GetSin());
+			halfExtents = AEVec2(c * tr.mScale.x + s * tr.mScale.y, s * tr.mScale.x + c * tr.mScale.y) * 0.5f;
+			break;
+		}
+		case CSHAPE_POLYGON:
+		{
+			// also refreshes the cached polygon for the narrowphase
+			body->UpdateWorldVertices();
+			if (body->mWorldVertices.empty())
+			{
+				out->mMin = out->mMax = tr.mTranslation;
+				return;
+			}
+			out->mMin = out->mMax = body->mWorldVertices[0];
+			FOR_EACH(it, body->mWorldVertices)
+			{
+				out->mMin = AEVec2((std::min)(out->mMin.x, it->x), (std::min)(out->mMin.y, it->y));
+				out->mMax = AEVec2((std::max)(out->mMax.x, it->x), (std::max)(out->mMax.y, it->y));
+			}
+			return;
+		}
+		default:
+			halfExtents = tr.mScale * 0.5f;
+			break;
+		}
+
+		out->mMin = tr.mTranslation - halfExtents;
+		out->mMax = tr.mTranslation + halfExtents;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		ComputeCCDRadius
+	// \brief	Circle inside the collider. Keeping it from crossing the static
+	//			bodies is enough to avoid tunneling, the discrete collision takes
+	//			care of the rest of the shape.
+	// ----------------------------------------------------------------------------
+	f32 ComputeCCDRadius(const Collider * body)
+	{
+		const AEVec2 & scale = body->mTransform->mLocal.mScale;
+		if (body->mCollisionShape == CSHAPE_CIRCLE)
+			return fabsf(scale.x);
+		if (body->mCollisionShape == CSHAPE_POLYGON)
+		{
+			// distance from the position to the closest edge (of the cached 
+			// polygon, the body may have moved since)
+			const AEVec2 & center = body->mWorldTransform.mTranslation;
+			f32 radius = FLT_MAX;
+			for (u32 i = 0; i < body->mWorldVertices.size(); ++i)
+				radius = (std::min)(radius, body->mWorldNormals[i] * (body->mWorldVertices[i] - center));
+			return body->mWorldVertices.empty() ? 0.0f : radius;
+		}
+		return 0.5f * (std::min)(fabsf(scale.x), fabsf(scale.y));
+	}
+
+	bool IsMovableBody(const Collider * body)
+	{
+		return body->mbDynamic && body->mRigidBody && body->mRigidBody->GetInvMass() > 0.0f;
+	}
+
+	bool IsAwakeBody(const Collider * body)
+	{
+		return IsMovableBody(body) && body->mRigidBody->IsAwake();
+	}
+
+	bool IsActiveBody(const Collider * body)
+	{
+		return body->mbDynamic && (!IsMovableBody(body) || body->mRigidBody->IsAwake());
+	}
+
 	#pragma endregion
 	// ----------------------------------------------------------------------------
 
@@ -162,213 +475,1392 @@ namespace AEX
 	/**************************************************************************/
 	/*!
 	  \fn    
-		ResolveContactPenetration
+		CollideAllBodies
 
 	  \brief 
-		Given the contact data, resolves the penetration of the two given bodies.
-
-	  \param body1
-		The first RigidBody to be tampered with.
-    
-	  \param body2
-		The second RigidBody to be tampered with.
-    
-	  \param contact
-		The contact data as an input.
+		Performs collision detection/resolution between dynamic and static bodies.
+		Runs the broadphase and the (multithreaded) narrowphase once, builds the
+		islands and then the sequential impulse solver iterates on the 
+		persistent manifolds of each awake island (in parallel).
 	*/
 	/**************************************************************************/
-	void CollisionSystem::ResolveContactPenetration(Collider * body1, Collider * body2, Contact * contact)
+	void CollisionSystem::CollideAllBodies()
 	{
-		// Compute the contact penetration as a vector
-		AEVec2 contactPen = contact->mNormal * contact->mPenetration;
+		// Initialize mCollisionsThisFrame to 0
+		mCollisionsThisFrame = 0;
+		++mStepCount;
+
+		f64 time = FRC::GetCPUTime();
+		auto phaseEnd = [this, &time](u32 phase)
+		{
+			f64 now = FRC::GetCPUTime();
+			mPhaseTimes[phase] += now - time;
+			time = now;
+		};
+
+		// the workers can't touch GetOwner()->GetComp(), cache everything they need
+		CacheBodyComponents();
+		UpdateFilterMasks();
+		UpdateStaticProxies();
+		phaseEnd(CPHASE_PREPARE);
+
+		// fast bodies can't tunnel through the static bodies
+		ContinuousPhase();
+		phaseEnd(CPHASE_CONTINUOUS);
 
-		// Get the massInfluence of each RigidBody
-		float invMass1 = GetRigidBodyByComp(body1)->mInvMass / (GetRigidBodyByComp(body1)->mInvMass + GetRigidBodyByComp(body2)->mInvMass);
-		float invMass2 = GetRigidBodyByComp(body2)->mInvMass / (GetRigidBodyByComp(body1)->mInvMass + GetRigidBodyByComp(body2)->mInvMass);
+		// detect once, the solver iterates on the cached contacts
+		BroadPhase();
+		phaseEnd(CPHASE_BROAD);
+		NarrowPhase();
+		phaseEnd(CPHASE_NARROW);
+		UpdateEvents();
+		phaseEnd(CPHASE_EVENTS);
+		UpdateManifolds();
+		phaseEnd(CPHASE_MANIFOLDS);
+		BuildIslands();
+		phaseEnd(CPHASE_ISLANDS);
+		SolveIslands();
+		phaseEnd(CPHASE_SOLVE);
 
-		// Calculate the position of each RigidBody depending on contactPen and each massInfluence
-		GetTransLocalByComp(body1).mTranslation -= contactPen * invMass1;
-		GetTransLocalByComp(body2).mTranslation += contactPen * invMass2;
+		// one batch per step, once the bodies are in their final place
+		DispatchEvents();
+		phaseEnd(CPHASE_EVENTS);
 
-		// Reset the acceleration of each RigidBody
-		GetRigidBodyByComp(body1)->mAcceleration = AEVec2();
-		GetRigidBodyByComp(body2)->mAcceleration = AEVec2();
+		// the solver moved the bodies, refit on the next scene query
+		mbQueryDynamicDirty = true;
 	}
 
 	/**************************************************************************/
 	/*!
 	  \fn    
-		ResolveContactVelocity
+		CacheBodyComponents
 
 	  \brief 
-		Given the contact data, resolves the velocity of the two given bodies.
-
-	  \param body1
-		The first RigidBody to be tampered with.
-    
-	  \param body2
-		The second RigidBody to be tampered with.
-    
-	  \param contact
-		The contact data as an input.
+		Resolves the transform and rigid body of every registered collider. 
+		Colliders without owner (e.g. created by hand) keep whatever was set.
+		The transforms are synced, so the workers can use their cached axes
+		(the physics doesn't rotate the bodies during the step), and the 
+		boxes are classified as AABB/OBB (see UpdateShapeClass).
 	*/
 	/**************************************************************************/
-	void CollisionSystem::ResolveContactVelocity(Collider * body1, Collider * body2, Contact * contact)
+	void CollisionSystem::CacheBodyComponents()
 	{
-		// Get the velocity differential (Relative velocity)
-		AEVec2 relVel = GetRigidBodyByComp(body2)->Velocity - GetRigidBodyByComp(body1)->Velocity;
-		// Get the separating velocity
-		float sep = relVel * contact->mNormal;
+		FOR_EACH(it, mDynamicBodies)
+		{
+			if ((*it)->mOwner)
+			{
+				(*it)->mTransform = GetTransByComp((*it));
+				(*it)->mRigidBody = GetRigidBodyByComp((*it));
+			}
+			if ((*it)->mRigidBody)
+				(*it)->mRigidBody->UpdateInvMass();
+			if ((*it)->mTransform)
+				(*it)->mTransform->Sync();
+			(*it)->UpdateShapeClass();
+		}
+		FOR_EACH(it, mStaticBodies)
+		{
+			if ((*it)->mOwner)
+			{
+				(*it)->mTransform = GetTransByComp((*it));
+				(*it)->mRigidBody = GetRigidBodyByComp((*it));
+			}
+			if ((*it)->mTransform)
+				(*it)->mTransform->Sync();
+			(*it)->UpdateShapeClass();
+		}
+	}
 
-		// If the separating velocity is higher than 0, they are alreading separating, so return
-		if (sep > 0)
-			return;
+	/**************************************************************************/
+	/*!
+	  \fn    
+		UpdateFilterMasks
+
+	  \brief 
+		Combines the mask of every collider with the rows of the layer matrix
+		of its categories, so the broadphase filter is just CanCollide.
+	*/
+	/**************************************************************************/
+	static void UpdateFilterMask(Collider * body, const u32 * layerMatrix)
+	{
+		u32 layers = 0;
+		for (u32 i = 0; i < COLLISION_LAYER_MAX; ++i)
+		{
+			if (body->mCategory & (1u << i))
+				layers |= layerMatrix[i];
+		}
+		body->mFilterMask = body->mMask & layers;
+	}
+
+	void CollisionSystem::UpdateFilterMasks()
+	{
+		FOR_EACH(it, mDynamicBodies)
+			UpdateFilterMask(*it, mLayerMatrix);
+		FOR_EACH(it, mStaticBodies)
+			UpdateFilterMask(*it, mLayerMatrix);
+	}
 
-		// Compute the mass influence pf each RigidBody
-		float massInfl1 = GetRigidBodyByComp(body1)->mInvMass / (GetRigidBodyByComp(body1)->mInvMass + GetRigidBodyByComp(body2)->mInvMass);
-		float massInfl2 = GetRigidBodyByComp(body2)->mInvMass / (GetRigidBodyByComp(body1)->mInvMass + GetRigidBodyByComp(body2)->mInvMass);
+	// sort predicate for the broadphase sweep. Ties are broken by id so that the
+	// order doesn't depend on the container order.
+	static bool ProxyMinXLess(const BroadPhaseProxy & a, const BroadPhaseProxy & b)
+	{
+		if (a.mBounds.mMin.x != b.mBounds.mMin.x)
+			return a.mBounds.mMin.x < b.mBounds.mMin.x;
+		return a.mCollider->mColliderID < b.mCollider->mColliderID;
+	}
+
+	static bool ProxyMinXLessThan(const BroadPhaseProxy & a, f32 x)
+	{
+		return a.mBounds.mMin.x < x;
+	}
+
+	static bool PairKeyLess(const ContactPair & a, const ContactPair & b)
+	{
+		return a.mKey < b.mKey;
+	}
 
-		float primeSep = -sep * DFLT_RESTITUTION;
-		float deltaSep = primeSep - sep;
+	static bool BoundsOverlap(const ColliderBounds & a, const ColliderBounds & b)
+	{
+		return a.mMin.x <= b.mMax.x && b.mMin.x <= a.mMax.x && a.mMin.y <= b.mMax.y && b.mMin.y <= a.mMax.y;
+	}
 
-		// Compute the new velocity of each RigidBody
-		GetRigidBodyByComp(body1)->Velocity -= contact->mNormal * deltaSep * (massInfl1 * massInfl1);
-		GetRigidBodyByComp(body2)->Velocity += contact->mNormal * deltaSep * (massInfl2 * massInfl2);
+	// Transform version of a static body. The ones without a transform (an
+	// owner without TransformComp) have none and aren't in the tree.
+	static u32 GetStaticVersion(Collider * body)
+	{
+		return body->mTransform ? body->mTransform->GetVersion() : 0xFFFFFFFF;
 	}
 
 	/**************************************************************************/
 	/*!
 	  \fn    
-		CollideAllBodies
+		UpdateStaticProxies
 
 	  \brief 
-		Performs brute force collision detection/resolution between dynamic and static bodies.
+		Rebuilds the static tree when static bodies were added or removed, or
+		one of them moved (e.g. in the editor). Otherwise it is only a pass 
+		comparing the transform versions. Used by the continuous phase, the broadphase
+		and the scene queries.
 	*/
 	/**************************************************************************/
-	void CollisionSystem::CollideAllBodies()
+	void CollisionSystem::UpdateStaticProxies()
 	{
-		// Initialize mCollisionsThisFrame to 0
-		mCollisionsThisFrame = 0;
+		if (!mbStaticDirty)
+		{
+			u32 i = 0;
+			FOR_EACH(it, mStaticBodies)
+			{
+				if (GetStaticVersion(*it) != mStaticVersions[i++])
+				{
+					mbStaticDirty = true;
+					break;
+				}
+			}
+			if (!mbStaticDirty)
+				return;
+		}
+
+		mStaticProxies.clear();
+		mStaticVersions.clear();
+		FOR_EACH(it, mStaticBodies)
+		{
+			mStaticVersions.push_back(GetStaticVersion(*it));
+			if (!(*it)->mTransform)
+				continue;
+			BroadPhaseProxy proxy;
+			proxy.mCollider = *it;
+			ComputeColliderBounds(*it, &proxy.mBounds);
+			mStaticProxies.push_back(proxy);
+		}
+
+		mStaticTree.clear();
+		if (!mStaticProxies.empty())
+			BuildStaticTree(0, mStaticProxies.size());
+		mbStaticDirty = false;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		BuildStaticTree
+	// \brief	Builds the node of the static proxies [begin, end) and its 
+	//			children, splitting at the median center along the longest axis.
+	//			Returns the index of the node.
+	// ----------------------------------------------------------------------------
+	u32 CollisionSystem::BuildStaticTree(u32 begin, u32 end)
+	{
+		const u32 leafSize = 4;
+		const u32 node = mStaticTree.size();
+		mStaticTree.push_back(StaticTreeNode());
+
+		ColliderBounds bounds = mStaticProxies[begin].mBounds;
+		AEVec2 centerMin = (bounds.mMin + bounds.mMax) * 0.5f, centerMax = centerMin;
+		for (u32 i = begin + 1; i < end; ++i)
+		{
+			const ColliderBounds & b = mStaticProxies[i].mBounds;
+			AEVec2 center = (b.mMin + b.mMax) * 0.5f;
+			bounds.mMin = AEVec2((std::min)(bounds.mMin.x, b.mMin.x), (std::min)(bounds.mMin.y, b.mMin.y));
+			bounds.mMax = AEVec2((std::max)(bounds.mMax.x, b.mMax.x), (std::max)(bounds.mMax.y, b.mMax.y));
+			centerMin = AEVec2((std::min)(centerMin.x, center.x), (std::min)(centerMin.y, center.y));
+			centerMax = AEVec2((std::max)(centerMax.x, center.x), (std::max)(centerMax.y, center.y));
+		}
+		mStaticTree[node].mBounds = bounds;
+
+		if (end - begin <= leafSize)
+		{
+			mStaticTree[node].mIndex = begin;
+			mStaticTree[node].mCount = end - begin;
+			return node;
+		}
+
+		// ties broken by id, the tree doesn't depend on the container order
+		const bool splitX = centerMax.x - centerMin.x >= centerMax.y - centerMin.y;
+		const u32 mid = (begin + end) / 2;
+		std::nth_element(mStaticProxies.begin() + begin, mStaticProxies.begin() + mid, mStaticProxies.begin() + end,
+			[splitX](const BroadPhaseProxy & a, const BroadPhaseProxy & b)
+		{
+			f32 ca = splitX ? a.mBounds.mMin.x + a.mBounds.mMax.x : a.mBounds.mMin.y + a.mBounds.mMax.y;
+			f32 cb = splitX ? b.mBounds.mMin.x + b.mBounds.mMax.x : b.mBounds.mMin.y + b.mBounds.mMax.y;
+			if (ca != cb)
+				return ca < cb;
+			return a.mCollider->mColliderID < b.mCollider->mColliderID;
+		});
 
-		//------------------------------------------------
-		// @NEW - Assignment 4_4
-		// Define an iterator for the mDynamicBodies list which will go through
-		std::list<Collider *>::iterator itA;
+		BuildStaticTree(begin, mid);
+		u32 second = BuildStaticTree(mid, end);
+		mStaticTree[node].mIndex = second;
+		mStaticTree[node].mCount = 0;
+		return node;
+	}
 
-		// Clear the mCollidedWith vectors (For both mDynamicBodies and mStaticBodies)
-		for (itA = mDynamicBodies.begin(); itA != mDynamicBodies.end(); itA++)
-			(*itA)->mCollidedWith.clear();
-		for (itA = mStaticBodies.begin(); itA != mStaticBodies.end(); itA++)
-			(*itA)->mCollidedWith.clear();
-		//------------------------------------------------
+	//!----------------------------------------------------------------------------
+	// \fn		QueryStaticTree
+	// \brief	Calls fn(proxy) for every static proxy that overlaps bounds.
+	// ----------------------------------------------------------------------------
+	template <typename Fn>
+	void CollisionSystem::QueryStaticTree(const ColliderBounds & bounds, Fn fn)
+	{
+		if (mStaticTree.empty())
+			return;
 
-		// Compute the collisions by n iterations
-		for (u32 n = 0; n < mCollisionIterations; n++)
+		// the tree is balanced, 64 levels is more than enough
+		u32 stack[64];
+		u32 top = 0;
+		stack[top++] = 0;
+		while (top)
 		{
-			// Use itA to go through the mDynamicBodies list
-			for (itA = mDynamicBodies.begin(); itA != mDynamicBodies.end(); itA++)
+			const u32 index = stack[--top];
+			const StaticTreeNode & node = mStaticTree[index];
+			if (!BoundsOverlap(node.mBounds, bounds))
+				continue;
+
+			if (node.mCount)
 			{
-				// Define another iterator; this time for the mDynamicBodies list
-				std::list<Collider *>::iterator itB = itA;
-				// increment by 1 itB
-				itB++;
-				// Use itB to go through the mDynamicBodies list
-				for (; itB != mDynamicBodies.end(); itB++)
+				for (u32 i = node.mIndex; i < node.mIndex + node.mCount; ++i)
 				{
-					// Get the collision function calling GetCollisionFn
-					CollisionFn colFn = GetCollisionFn(*itA, *itB);
-					// Initialize contactResolution
-					Contact contactResolution;
-
-					// Check if both RigidBodies are colliding
-					if (colFn(*itA, *itB, &contactResolution))
-					{
-						//------------------------------------------------
-						// @NEW - Assignment 4_4
-						(*itA)->mbHasCollided = true;
-						(*itB)->mbHasCollided = true;
-						PushIfNotDuplicate((*itA)->mCollidedWith, *itB);
-						PushIfNotDuplicate((*itB)->mCollidedWith, *itA);
-
-						if ((*itA)->IsGhost || (*itB)->IsGhost)
-							continue;
-						//------------------------------------------------
-
-						// Resolve the contact penetation between each body
-						ResolveContactPenetration(*itA, *itB, &contactResolution);
-
-						// If it's the first iteration, resolve the contact velocity between each body and increment mCollisionsThisFrame
-						if (n == 0)
-						{
-							ResolveContactVelocity(*itA, *itB, &contactResolution);
-							mCollisionsThisFrame++;
-						}
-					}
+					if (BoundsOverlap(mStaticProxies[i].mBounds, bounds))
+						fn(mStaticProxies[i]);
 				}
+			}
+			else
+			{
+				stack[top++] = node.mIndex;
+				stack[top++] = index + 1;
+			}
+		}
+	}
 
-				// Use itB to go through the mStaticBodies list
-				for (itB = mStaticBodies.begin(); itB != mStaticBodies.end(); itB++)
-				{
-					// Get the collision function calling GetCollisionFn
-					CollisionFn colFn = GetCollisionFn(*itA, *itB);
-					// Initialize contactResolution
-					Contact contactResolution;
+	// Entry time of the ray into the convex polygon grown by 'inflate' along the
+	// edge normals (Cyrus-Beck clipping). -1 if it misses, 0 and outInside if 
+	// the origin is already inside.
+	static f32 RayCastConvex(const AEVec2 & origin, const AEVec2 & dir, const AEVec2 * vertices, const AEVec2 * normals, u32 count,
+							 f32 inflate, bool * outInside)
+	{
+		f32 enter = 0.0f, exit = FLT_MAX;
+		*outInside = count > 0;
+		for (u32 i = 0; i < count; ++i)
+		{
+			f32 dist = normals[i] * (origin - vertices[i]) - inflate; // > 0 outside of the edge
+			f32 speed = normals[i] * dir;
+			if (dist > 0.0f)
+				*outInside = false;
+			if (speed == 0.0f)
+			{
+				if (dist > 0.0f)
+					return -1.0f; // parallel and outside
+				continue;
+			}
 
-					// Check if both RigidBodies are colliding
-					if (colFn(*itA, *itB, &contactResolution))
-					{
-						//------------------------------------------------
-						// @NEW - Assignment 4_4
-						(*itA)->mbHasCollided = true;
-						(*itB)->mbHasCollided = true;
-						(*itA)->mCollidedWith.push_back(*itB);
-						(*itB)->mCollidedWith.push_back(*itA);
-
-						if ((*itA)->IsGhost || (*itB)->IsGhost)
-							continue;
-						//------------------------------------------------
-
-						// Resolve the contact penetation between each body
-						ResolveContactPenetration(*itA, *itB, &contactResolution);
-
-						// If it's the first iteration, resolve the contact velocity between each body and increment mCollisionsThisFrame
-						if (n == 0)
-						{
-							ResolveContactVelocity(*itA, *itB, &contactResolution);
-							mCollisionsThisFrame++;
-						}
-					}
-				}
+			f32 t = -dist / speed;
+			if (speed < 0.0f)
+				enter = (std::max)(enter, t);
+			else
+				exit = (std::min)(exit, t);
+			if (enter > exit)
+				return -1.0f;
+		}
+		return count ? enter : -1.0f;
+	}
+
+	// Time of impact (as a fraction of motion) of a circle moving from start
+	// against the target. Negative if there's no hit or if the circle already
+	// overlaps the target (the discrete collision handles that case).
+	static f32 SweepCircleAgainst(const AEVec2 & start, const AEVec2 & motion, f32 radius, Collider * target)
+	{
+		Transform tr = target->mTransform->mLocal;
+		AEVec2 point = start;
+
+		if (target->mCollisionShape == CSHAPE_CIRCLE)
+		{
+			f32 r = tr.mScale.x + radius;
+			if (StaticPointToStaticCircle(&point, &tr.mTranslation, r))
+				return -1.0f;
+			return RayCastCircle(start, motion, tr.mTranslation, r, NULL);
+		}
+
+		// polygons: clipped against the edges pushed out by the radius (sharp 
+		// corners, like the boxes below)
+		if (target->mCollisionShape == CSHAPE_POLYGON)
+		{
+			const AEVec2 * vertices, * normals;
+			u32 vertexCount = GetColliderPolygon(target, NULL, NULL, &vertices, &normals);
+			bool inside;
+			f32 t = RayCastConvex(start, motion, vertices, normals, vertexCount, radius, &inside);
+			return inside ? -1.0f : t;
+		}
+
+		// boxes: raycast against the box grown by the radius (square corners,
+		// so the impact is found slightly early, never late)
+		if (target->mCollisionShape == CSHAPE_AABB)
+			tr.mOrientation = 0.0f;
+		tr.mScale += AEVec2(2.0f * radius, 2.0f * radius);
+		if (StaticPointToOrientedRect(&point, &tr.mTranslation, tr.mScale.x, tr.mScale.y, tr.mOrientation))
+			return -1.0f;
+
+		AEVec2 pi;
+		f32 t = RayCastRect(start, motion, tr, &pi);
+		return t < FLT_MAX ? t : -1.0f;
+	}
+
+	/**************************************************************************/
+	/*!
+	  \fn    
+		ContinuousPhase
+
+	  \brief 
+		Sweeps the bullets (and the bodies that moved more than 
+		mCCDMotionThreshold times their CCD radius) from the position before
+		their last integration to the current one, against the static bodies 
+		under the swept bounds. Bodies that would have tunneled are moved back
+		to the first time of impact, slightly into the static body so that the
+		discrete collision generates the contact (and the response) this step.
+	*/
+	/**************************************************************************/
+	void CollisionSystem::ContinuousPhase()
+	{
+		mCCDBodiesThisFrame = 0;
+		mTOIHitsThisFrame = 0;
+		if (!mbContinuousCollision)
+			return;
+
+		FOR_EACH(it, mDynamicBodies)
+		{
+			Collider * body = *it;
+			if (!IsAwakeBody(body) || body->IsGhost || !body->mTransform)
+				continue;
+
+			RigidBody * rb = body->mRigidBody;
+			AEVec2 & position = body->mTransform->mLocal.mTranslation;
+			AEVec2 motion = position - rb->mStepStart;
+			f32 distSq = motion * motion;
+			f32 radius = ComputeCCDRadius(body);
+			if (distSq == 0.0f || radius <= 0.0f)
+				continue;
+			f32 threshold = mCCDMotionThreshold * radius;
+			if (!rb->IsBullet && distSq <= threshold * threshold)
+				continue;
+			mCCDBodiesThisFrame++;
+
+			// swept bounds
+			ColliderBounds swept;
+			swept.mMin = AEVec2((std::min)(rb->mStepStart.x, position.x) - radius, (std::min)(rb->mStepStart.y, position.y) - radius);
+			swept.mMax = AEVec2((std::max)(rb->mStepStart.x, position.x) + radius, (std::max)(rb->mStepStart.y, position.y) + radius);
+
+			// first impact against the static candidates
+			f32 toi = 1.0f;
+			QueryStaticTree(swept, [&](const BroadPhaseProxy & st)
+			{
+				if (st.mCollider->IsGhost || !CanCollide(body, st.mCollider))
+					return;
+
+				f32 t = SweepCircleAgainst(rb->mStepStart, motion, radius, st.mCollider);
+				if (t >= 0.0f && t < toi)
+					toi = t;
+			});
+
+			if (toi >= 1.0f)
+				continue;
+
+			// clamp, going in by the slop so the contact is detected
+			mTOIHitsThisFrame++;
+			f32 dist = sqrtf(distSq);
+			f32 travel = (std::min)(toi * dist + mSolverSettings.mLinearSlop, dist);
+			position = rb->mStepStart + motion * (travel / dist);
+		}
+	}
+
+	/**************************************************************************/
+	/*!
+	  \fn    
+		BroadPhase
+
+	  \brief 
+		Sort and sweep on the x axis. Dynamic bodies are swept against each other
+		and every dynamic body queries the static tree. Generates the
+		candidate pairs in mPairs. Dynamic-dynamic pairs are ordered by id, in
+		dynamic-static pairs the dynamic body always comes first. Pairs where 
+		no body is awake are skipped.
+	*/
+	/**************************************************************************/
+	void CollisionSystem::BroadPhase()
+	{
+		mPairs.clear();
+		mDynamicProxies.clear();
+
+		// compute the bounds (the static tree is up to date, see UpdateStaticProxies)
+		FOR_EACH(it, mDynamicBodies)
+		{
+			if (!(*it)->mTransform)
+				continue;	// no TransformComp, nothing to collide
+			BroadPhaseProxy proxy;
+			proxy.mCollider = *it;
+			ComputeColliderBounds(*it, &proxy.mBounds);
+			mDynamicProxies.push_back(proxy);
+		}
+
+		std::sort(mDynamicProxies.begin(), mDynamicProxies.end(), ProxyMinXLess);
+
+		for (u32 i = 0; i < mDynamicProxies.size(); ++i)
+		{
+			const BroadPhaseProxy & a = mDynamicProxies[i];
+			const bool aActive = IsActiveBody(a.mCollider);
+
+			// dynamic vs dynamic: everything starting before a ends
+			for (u32 j = i + 1; j < mDynamicProxies.size(); ++j)
+			{
+				const BroadPhaseProxy & b = mDynamicProxies[j];
+				if (b.mBounds.mMin.x > a.mBounds.mMax.x)
+					break;
+				if (b.mBounds.mMin.y > a.mBounds.mMax.y || b.mBounds.mMax.y < a.mBounds.mMin.y)
+					continue;
+				if (!aActive && !IsActiveBody(b.mCollider))
+					continue;
+				if (!CanCollide(a.mCollider, b.mCollider))
+					continue;
+
+				ColliderPair pair;
+				bool aFirst = a.mCollider->mColliderID < b.mCollider->mColliderID;
+				pair.mBody1 = aFirst ? a.mCollider : b.mCollider;
+				pair.mBody2 = aFirst ? b.mCollider : a.mCollider;
+				pair.mKey = MakePairKey(a.mCollider, b.mCollider);
+				mPairs.push_back(pair);
 			}
+
+			// dynamic vs static: sleeping bodies stay where they are
+			if (!aActive)
+				continue;
+
+			QueryStaticTree(a.mBounds, [&](const BroadPhaseProxy & b)
+			{
+				if (!CanCollide(a.mCollider, b.mCollider))
+					return;
+
+				ColliderPair pair;
+				pair.mBody1 = a.mCollider;
+				pair.mBody2 = b.mCollider;
+				pair.mKey = MakePairKey(a.mCollider, b.mCollider);
+				mPairs.push_back(pair);
+			});
 		}
+
+		mPairsThisFrame = mPairs.size();
 	}
-	//------------------------------------------------
-	// @NEW - Assignment 4_4
+
 	/**************************************************************************/
 	/*!
 	  \fn    
-		PushIfNotDuplicate
+		NarrowPhase
 
 	  \brief 
-		Given the inputted parameters, check if the RigidBody* is included in
-		the vector. If not, pushes back the RigidBody* to the list.
-
-	  \param vec
-		The RigidBody pointer vector we want to check in.
-    
-	  \param RB
-		The pointer to a RigidBody we want to compute with.
+		Runs the shape tests of mPairs on the worker pool. Each worker writes to
+		its own contact buffer, the buffers are then merged and sorted by pair 
+		key so the solver gets the same contacts whatever the thread count.
 	*/
 	/**************************************************************************/
-	void PushIfNotDuplicate(std::vector<Collider *> & vec, Collider * RB)
+	void CollisionSystem::NarrowPhase()
 	{
-		for (u32 i = 0; i < vec.size(); i++)
-			if (vec[i] == RB)
-				return;
+		FOR_EACH(it, mThreadContacts)
+			it->clear();
 
-		vec.push_back(RB);
+		mWorkers.ParallelFor(mPairs.size(), mNarrowPhaseGrain, [this](u32 worker, u32 begin, u32 end)
+		{
+			std::vector<ContactPair> & out = mThreadContacts[worker];
+			for (u32 i = begin; i < end; ++i)
+			{
+				const ColliderPair & pair = mPairs[i];
+
+				// Get the collision function calling GetCollisionFn
+				CollisionFn colFn = GetCollisionFn(pair.mBody1, pair.mBody2);
+				if (!colFn)
+					continue;
+
+				ContactPair contact;
+				if (colFn(pair.mBody1, pair.mBody2, &contact.mContact))
+				{
+					contact.mBody1 = pair.mBody1;
+					contact.mBody2 = pair.mBody2;
+					contact.mKey = pair.mKey;
+					out.push_back(contact);
+				}
+			}
+		});
+
+		// merge
+		mContacts.clear();
+		FOR_EACH(it, mThreadContacts)
+			mContacts.insert(mContacts.end(), it->begin(), it->end());
+
+		// keys are unique, so this is a total order
+		std::sort(mContacts.begin(), mContacts.end(), PairKeyLess);
+	}
+
+	/**************************************************************************/
+	/*!
+	  \fn    
+		UpdateEvents
+
+	  \brief 
+		Updates the set of touching pairs with the contacts of this step and 
+		records the transitions in mEvents: CEVENT_BEGIN for new pairs, 
+		CEVENT_STAY for the ones that were already touching and CEVENT_END for
+		the ones that stopped. Pairs where no body is awake weren't tested, so 
+		they stay active without reporting anything.
+	*/
+	/**************************************************************************/
+	void CollisionSystem::UpdateEvents()
+	{
+		mEvents.clear();
+
+		CollisionEvent ev;
+		FOR_EACH(it, mContacts)
+		{
+			// find first: insert allocates a node even when the key is there
+			auto found = mActivePairs.find(it->mKey);
+			const bool begin = found == mActivePairs.end();
+			if (begin)
+			{
+				ActivePair active = { it->mBody1, it->mBody2, mStepCount };
+				mActivePairs.insert(std::make_pair(it->mKey, active));
+			}
+			else
+				found->second.mLastFrame = mStepCount;
+
+			ev.mType = begin ? CEVENT_BEGIN : CEVENT_STAY;
+			ev.mBody1 = it->mBody1;
+			ev.mBody2 = it->mBody2;
+			ev.mKey = it->mKey;
+			ev.mContact = it->mContact;
+			mEvents.push_back(ev);
+		}
+
+		// mContacts is sorted by key, only the end events need sorting
+		const u32 contactEvents = mEvents.size();
+		for (auto it = mActivePairs.begin(); it != mActivePairs.end();)
+		{
+			const ActivePair & pair = it->second;
+			if (pair.mLastFrame == mStepCount || (!IsActiveBody(pair.mBody1) && !IsActiveBody(pair.mBody2)))
+			{
+				++it;
+				continue;
+			}
+
+			ev.mType = CEVENT_END;
+			ev.mBody1 = pair.mBody1;
+			ev.mBody2 = pair.mBody2;
+			ev.mKey = it->first;
+			ev.mContact = Contact();
+			mEvents.push_back(ev);
+			it = mActivePairs.erase(it);
+		}
+		std::sort(mEvents.begin() + contactEvents, mEvents.end(), 
+			[](const CollisionEvent & a, const CollisionEvent & b) { return a.mKey < b.mKey; });
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		DispatchEvents
+	// \brief	Hands the events of the step to every listener, in the order they
+	//			were added, and queues them on the event bus.
+	// ----------------------------------------------------------------------------
+	void CollisionSystem::DispatchEvents()
+	{
+		if (mEvents.empty())
+			return;
+		for (u32 i = 0; i < mEventListeners.size(); ++i)
+			mEventListeners[i].second(mEvents);
+
+		// and to the event bus, dispatched on the main thread after the systems
+		if (aexEvents->HasSubscribers<CollisionEvent>())
+		{
+			FOR_EACH(it, mEvents)
+				aexEvents->Publish(*it);
+		}
+	}
+
+	// ----------------------------------------------------------------------------
+	// Collision events
+	u32 CollisionSystem::AddEventListener(const CollisionEventFn & fn)
+	{
+		mEventListeners.push_back(std::make_pair(++mNextListenerID, fn));
+		return mNextListenerID;
+	}
+	void CollisionSystem::RemoveEventListener(u32 id)
+	{
+		for (auto it = mEventListeners.begin(); it != mEventListeners.end(); ++it)
+		{
+			if (it->first == id)
+			{
+				mEventListeners.erase(it);
+				return;
+			}
+		}
+	}
+
+	/**************************************************************************/
+	/*!
+	  \fn    
+		UpdateManifolds
+
+	  \brief 
+		Refreshes the persistent manifolds with the contacts of this step. New 
+		manifolds (or ones whose normal changed too much) start with no impulse,
+		the rest keep last step's impulse to warm start the solver. Manifolds of
+		pairs that stopped touching are dropped, except the ones of sleeping
+		bodies (they weren't tested, and they link the sleeping islands).
+	*/
+	/**************************************************************************/
+	void CollisionSystem::UpdateManifolds()
+	{
+		FOR_EACH(it, mContacts)
+		{
+			Collider * body1 = it->mBody1, * body2 = it->mBody2;
+
+			// ghosts only report events
+			if (body1->IsGhost || body2->IsGhost)
+				continue;
+
+			// find first, like the active pairs
+			auto found = mManifolds.find(it->mKey);
+			const bool created = found == mManifolds.end();
+			if (created)
+				found = mManifolds.insert(std::make_pair(it->mKey, ContactManifold())).first;
+			ContactManifold & manifold = found->second;
+			if (created || manifold.mContact.mNormal * it->mContact.mNormal < mWarmStartNormalTolerance)
+				manifold.mNormalImpulse = 0.0f;
+			manifold.mBody1 = body1;
+			manifold.mBody2 = body2;
+			manifold.mContact = it->mContact;
+			manifold.mKey = it->mKey;
+			manifold.mLastFrame = mStepCount;
+		}
+
+		// drop the pairs that stopped touching
+		for (auto it = mManifolds.begin(); it != mManifolds.end();)
+		{
+			const ContactManifold & m = it->second;
+			if (m.mLastFrame != mStepCount && (IsActiveBody(m.mBody1) || IsActiveBody(m.mBody2)))
+				it = mManifolds.erase(it);
+			else
+				++it;
+		}
+	}
+
+	// union-find helpers, the lowest index is always the root
+	static u32 FindIslandRoot(std::vector<u32> & parent, u32 i)
+	{
+		while (parent[i] != i)
+		{
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	}
+
+	static void UnionIslands(std::vector<u32> & parent, u32 a, u32 b)
+	{
+		a = FindIslandRoot(parent, a);
+		b = FindIslandRoot(parent, b);
+		if (a < b)
+			parent[b] = a;
+		else if (b < a)
+			parent[a] = b;
+	}
+
+	static bool ConstraintKeyLess(const ContactConstraint & a, const ContactConstraint & b)
+	{
+		return a.mManifold->mKey < b.mManifold->mKey;
+	}
+
+	u64 CollisionSystem::ComputeContactChecksum() const
+	{
+		// the sum of the hashes of each manifold, so the iteration order of 
+		// the map doesn't matter
+		u64 checksum = mManifolds.size();
+		FOR_EACH(it, mManifolds)
+		{
+			const ContactManifold & manifold = it->second;
+			u64 hash = HashBytes(AEX_HASH_SEED, &manifold.mKey, sizeof(manifold.mKey));
+			hash = HashBytes(hash, &manifold.mContact.mPi, sizeof(AEVec2));
+			hash = HashBytes(hash, &manifold.mContact.mNormal, sizeof(AEVec2));
+			hash = HashBytes(hash, &manifold.mContact.mPenetration, sizeof(f32));
+			hash = HashBytes(hash, &manifold.mNormalImpulse, sizeof(f32));
+			checksum += hash;
+		}
+		return checksum;
+	}
+
+	/**************************************************************************/
+	/*!
+	  \fn    
+		BuildIslands
+
+	  \brief 
+		Builds the solver constraints from the manifolds and groups the movable
+		bodies connected by them in islands (union-find). Static bodies don't 
+		link islands. An island with any awake body, or touched this step by
+		a dynamic body with no mass (those don't sleep), is woken up completely.
+		Bodies and constraints are then sorted by island (stable, so everything
+		stays in registration/key order inside each island).
+	*/
+	/**************************************************************************/
+	void CollisionSystem::BuildIslands()
+	{
+		// movable bodies
+		mMovableBodies.clear();
+		FOR_EACH(it, mDynamicBodies)
+		{
+			if (IsMovableBody(*it))
+			{
+				(*it)->mSolverIndex = mMovableBodies.size();
+				mMovableBodies.push_back(*it);
+			}
+		}
+
+		// constraints, in key order
+		mConstraints.clear();
+		FOR_EACH(it, mManifolds)
+		{
+			ContactManifold & manifold = it->second;
+			Collider * body1 = manifold.mBody1, * body2 = manifold.mBody2;
+
+			// static bodies and bodies without RigidBody don't move
+			RigidBody * rb1 = body1->mRigidBody, * rb2 = body2->mRigidBody;
+			ContactConstraint c;
+			c.mManifold = &manifold;
+			c.mVelocity1 = rb1 ? &rb1->Velocity : &mZeroVelocity;
+			c.mVelocity2 = rb2 ? &rb2->Velocity : &mZeroVelocity;
+			c.mPosition1 = &body1->mTransform->mLocal.mTranslation;
+			c.mPosition2 = &body2->mTransform->mLocal.mTranslation;
+			c.mInvMass1 = IsMovableBody(body1) ? rb1->GetInvMass() : 0.0f;
+			c.mInvMass2 = IsMovableBody(body2) ? rb2->GetInvMass() : 0.0f;
+			if (c.mInvMass1 + c.mInvMass2 > 0.0f)
+				mConstraints.push_back(c);
+		}
+		std::sort(mConstraints.begin(), mConstraints.end(), ConstraintKeyLess);
+
+		// union-find over the contact graph
+		const u32 bodyCount = mMovableBodies.size();
+		mIslandParent.resize(bodyCount);
+		for (u32 i = 0; i < bodyCount; ++i)
+			mIslandParent[i] = i;
+		FOR_EACH(it, mConstraints)
+		{
+			if (it->mInvMass1 && it->mInvMass2)
+				UnionIslands(mIslandParent, it->mManifold->mBody1->mSolverIndex, it->mManifold->mBody2->mSolverIndex);
+		}
+
+		// one island per root. Roots are the lowest index of their set, so they
+		// are always found before the rest of their bodies.
+		mIslands.clear();
+		mBodyIsland.resize(bodyCount);
+		for (u32 i = 0; i < bodyCount; ++i)
+		{
+			u32 root = FindIslandRoot(mIslandParent, i);
+			if (root == i)
+			{
+				ContactIsland island = { 0, 0, 0, 0, false };
+				mBodyIsland[i] = mIslands.size();
+				mIslands.push_back(island);
+			}
+			else
+				mBodyIsland[i] = mBodyIsland[root];
+
+			ContactIsland & island = mIslands[mBodyIsland[i]];
+			island.mBodyCount++;
+			island.mbAwake = island.mbAwake || IsAwakeBody(mMovableBodies[i]);
+		}
+		FOR_EACH(it, mConstraints)
+		{
+			Collider * body = it->mInvMass1 ? it->mManifold->mBody1 : it->mManifold->mBody2;
+			Collider * other = it->mInvMass1 ? it->mManifold->mBody2 : it->mManifold->mBody1;
+			ContactIsland & island = mIslands[mBodyIsland[body->mSolverIndex]];
+			island.mConstraintCount++;
+
+			// touched by a dynamic body that never sleeps (kinematic)
+			if (!IsMovableBody(other) && other->mbDynamic && it->mManifold->mLastFrame == mStepCount)
+				island.mbAwake = true;
+		}
+
+		// ranges
+		u32 bodyBegin = 0, constraintBegin = 0;
+		FOR_EACH(it, mIslands)
+		{
+			it->mBodyBegin = bodyBegin;
+			it->mConstraintBegin = constraintBegin;
+			bodyBegin += it->mBodyCount;
+			constraintBegin += it->mConstraintCount;
+
+			// used as insertion cursors below
+			it->mBodyCount = 0;
+			it->mConstraintCount = 0;
+		}
+
+		// sort by island
+		mIslandBodies.resize(bodyCount);
+		for (u32 i = 0; i < bodyCount; ++i)
+		{
+			ContactIsland & island = mIslands[mBodyIsland[i]];
+			mIslandBodies[island.mBodyBegin + island.mBodyCount++] = mMovableBodies[i];
+		}
+		mSortedConstraints.resize(mConstraints.size());
+		FOR_EACH(it, mConstraints)
+		{
+			Collider * body = it->mInvMass1 ? it->mManifold->mBody1 : it->mManifold->mBody2;
+			ContactIsland & island = mIslands[mBodyIsland[body->mSolverIndex]];
+			mSortedConstraints[island.mConstraintBegin + island.mConstraintCount++] = *it;
+		}
+		mConstraints.swap(mSortedConstraints);
+
+		// something touched the island, wake it up completely
+		mAwakeIslands.clear();
+		for (u32 i = 0; i < mIslands.size(); ++i)
+		{
+			const ContactIsland & island = mIslands[i];
+			if (!island.mbAwake)
+				continue;
+
+			for (u32 b = 0; b < island.mBodyCount; ++b)
+				mIslandBodies[island.mBodyBegin + b]->mRigidBody->SetAwake(true);
+			mAwakeIslands.push_back(i);
+		}
+	}
+
+	/**************************************************************************/
+	/*!
+	  \fn    
+		SolveIslands
+
+	  \brief 
+		Solves the awake islands in parallel (they don't share movable bodies)
+		and updates the body/island counters.
+	*/
+	/**************************************************************************/
+	void CollisionSystem::SolveIslands()
+	{
+		mWorkers.ParallelFor(mAwakeIslands.size(), 1, [this](u32, u32 begin, u32 end)
+		{
+			for (u32 i = begin; i < end; ++i)
+				SolveIsland(mIslands[mAwakeIslands[i]]);
+		});
+
+		// counters
+		mCollisionsThisFrame = 0;
+		mActiveBodies = mSleepingBodies = 0;
+		mActiveIslands = mSleepingIslands = 0;
+		FOR_EACH(it, mIslands)
+		{
+			// the bodies of an island are either all awake or all sleeping
+			if (mIslandBodies[it->mBodyBegin]->mRigidBody->IsAwake())
+			{
+				mActiveIslands++;
+				mActiveBodies += it->mBodyCount;
+				mCollisionsThisFrame += it->mConstraintCount;
+			}
+			else
+			{
+				mSleepingIslands++;
+				mSleepingBodies += it->mBodyCount;
+			}
+		}
+	}
+
+	/**************************************************************************/
+	/*!
+	  \fn    
+		SolveIsland
+
+	  \brief 
+		Solves the contacts of the island and advances the sleep timers of its
+		bodies. When all of them have been slow for mTimeToSleep, the whole 
+		island goes to sleep. Runs on the workers: only touches the island.
+	*/
+	/**************************************************************************/
+	void CollisionSystem::SolveIsland(const ContactIsland & island)
+	{
+		if (island.mConstraintCount)
+			SolveContactConstraints(&mConstraints[island.mConstraintBegin], island.mConstraintCount, mSolverSettings);
+
+		if (!mbAllowSleeping)
+			return;
+
+		const f32 linTolSq = mSleepLinearTolerance * mSleepLinearTolerance;
+		f32 minSleepTime = mTimeToSleep;
+		for (u32 i = 0; i < island.mBodyCount; ++i)
+		{
+			RigidBody * rb = mIslandBodies[island.mBodyBegin + i]->mRigidBody;
+			if (rb->Velocity * rb->Velocity > linTolSq || fabsf(rb->AngularVelocity) > mSleepAngularTolerance)
+				rb->mSleepTime = 0.0f;
+			else
+				rb->mSleepTime += mTimeStep;
+
+			if (rb->mSleepTime < minSleepTime)
+				minSleepTime = rb->mSleepTime;
+		}
+
+		if (minSleepTime >= mTimeToSleep)
+		{
+			for (u32 i = 0; i < island.mBodyCount; ++i)
+				mIslandBodies[island.mBodyBegin + i]->mRigidBody->SetAwake(false);
+		}
+	}
+
+	#pragma endregion
+	// ----------------------------------------------------------------------------
+
+	// ----------------------------------------------------------------------------
+	#pragma region // Scene Queries
+
+	//!----------------------------------------------------------------------------
+	// \fn		UpdateQueryProxies
+	// \brief	Brings the broadphase proxies up to date for the scene queries.
+	//			The static tree is only rebuilt when bodies were added or 
+	//			removed (the step checks the moved ones), the dynamic proxies 
+	//			are refitted once after each step.
+	// ----------------------------------------------------------------------------
+	void CollisionSystem::UpdateQueryProxies()
+	{
+		if (mbStaticDirty)
+		{
+			CacheBodyComponents();
+			UpdateStaticProxies();
+		}
+		if (!mbQueryDynamicDirty)
+			return;
+
+		mDynamicProxies.clear();
+		mDynamicMaxWidth = 0.0f;
+		FOR_EACH(it, mDynamicBodies)
+		{
+			if (!(*it)->mTransform)
+				continue;
+			(*it)->mTransform->Sync();
+			BroadPhaseProxy proxy;
+			proxy.mCollider = *it;
+			ComputeColliderBounds(*it, &proxy.mBounds);
+			mDynamicMaxWidth = (std::max)(mDynamicMaxWidth, proxy.mBounds.mMax.x - proxy.mBounds.mMin.x);
+			mDynamicProxies.push_back(proxy);
+		}
+		std::sort(mDynamicProxies.begin(), mDynamicProxies.end(), ProxyMinXLess);
+		mbQueryDynamicDirty = false;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		QueryProxies
+	// \brief	Calls fn(proxy) for the static and dynamic proxies that overlap
+	//			bounds and whose category is in mask.
+	// ----------------------------------------------------------------------------
+	template <typename Fn>
+	void CollisionSystem::QueryProxies(const ColliderBounds & bounds, u32 mask, Fn fn)
+	{
+		UpdateQueryProxies();
+
+		QueryStaticTree(bounds, [&](const BroadPhaseProxy & proxy)
+		{
+			if (proxy.mCollider->mCategory & mask)
+				fn(proxy);
+		});
+
+		auto first = std::lower_bound(mDynamicProxies.begin(), mDynamicProxies.end(), bounds.mMin.x - mDynamicMaxWidth, ProxyMinXLessThan);
+		for (auto it = first; it != mDynamicProxies.end(); ++it)
+		{
+			const ColliderBounds & b = it->mBounds;
+			if (b.mMin.x > bounds.mMax.x)
+				break;
+			if (b.mMax.x < bounds.mMin.x || b.mMin.y > bounds.mMax.y || b.mMax.y < bounds.mMin.y)
+				continue;
+			if (!(it->mCollider->mCategory & mask))
+				continue;
+			fn(*it);
+		}
+	}
+
+	// Time of impact of the ray against the collider (as a factor of dir), 0
+	// if the origin is inside and -1 if it misses.
+	static f32 RayCastCollider(const AEVec2 & origin, const AEVec2 & dir, Collider * body)
+	{
+		Transform tr = body->mTransform->mLocal;
+		AEVec2 point = origin;
+
+		if (body->mCollisionShape == CSHAPE_CIRCLE)
+		{
+			if (StaticPointToStaticCircle(&point, &tr.mTranslation, tr.mScale.x))
+				return 0.0f;
+			return RayCastCircle(origin, dir, tr.mTranslation, tr.mScale.x, NULL);
+		}
+
+		if (body->mCollisionShape == CSHAPE_POLYGON)
+		{
+			const AEVec2 * vertices, * normals;
+			u32 vertexCount = GetColliderPolygon(body, NULL, NULL, &vertices, &normals);
+			bool inside;
+			return RayCastConvex(origin, dir, vertices, normals, vertexCount, 0.0f, &inside);
+		}
+
+		if (body->mCollisionShape == CSHAPE_AABB)
+			tr.mOrientation = 0.0f;
+		if (StaticPointToOrientedRect(&point, &tr.mTranslation, tr.mScale.x, tr.mScale.y, tr.mOrientation))
+			return 0.0f;
+		// RayCastLine only finds the hit with an out point
+		AEVec2 hit;
+		f32 t = RayCastRect(origin, dir, tr, &hit);
+		return t < FLT_MAX ? t : -1.0f;
+	}
+
+	// Bounds of the segment origin -> origin + dir * maxTime
+	static void ComputeRayBounds(const AEVec2 & origin, const AEVec2 & dir, f32 maxTime, ColliderBounds * out)
+	{
+		AEVec2 end = origin + dir * maxTime;
+		out->mMin = AEVec2((std::min)(origin.x, end.x), (std::min)(origin.y, end.y));
+		out->mMax = AEVec2((std::max)(origin.x, end.x), (std::max)(origin.y, end.y));
+	}
+
+	// Hit order: time, then collider id (same result whatever the proxy order)
+	static bool RayCastHitLess(const RayCastHit & a, const RayCastHit & b)
+	{
+		if (a.mTime != b.mTime)
+			return a.mTime < b.mTime;
+		return a.mCollider->mColliderID < b.mCollider->mColliderID;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		RayCastClosest
+	// \brief	First collider hit by the ray before maxTime.
+	// ----------------------------------------------------------------------------
+	bool CollisionSystem::RayCastClosest(const Ray & ray, f32 maxTime, u32 mask, RayCastHit * outHit)
+	{
+		RayCastHit best;
+		best.mCollider = NULL;
+		best.mTime = maxTime;
+		if (ray.mDirection * ray.mDirection == 0.0f || maxTime < 0.0f)
+			return false;
+
+		ColliderBounds bounds;
+		ComputeRayBounds(ray.mOrigin, ray.mDirection, maxTime, &bounds);
+		QueryProxies(bounds, mask, [&](const BroadPhaseProxy & proxy)
+		{
+			RayCastHit hit;
+			hit.mCollider = proxy.mCollider;
+			hit.mTime = RayCastCollider(ray.mOrigin, ray.mDirection, proxy.mCollider);
+			if (hit.mTime < 0.0f || hit.mTime > best.mTime)
+				return;
+			if (!best.mCollider || RayCastHitLess(hit, best))
+				best = hit;
+		});
+
+		if (!best.mCollider)
+			return false;
+		best.mPoint = ray.mOrigin + ray.mDirection * best.mTime;
+		if (outHit)
+			*outHit = best;
+		return true;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		RayCastAll
+	// \brief	Colliders hit by the ray before maxTime, closest first. If there
+	//			are more than maxHits only the closest ones are kept.
+	// ----------------------------------------------------------------------------
+	u32 CollisionSystem::RayCastAll(const Ray & ray, f32 maxTime, u32 mask, RayCastHit * outHits, u32 maxHits)
+	{
+		u32 count = 0;
+		if (!outHits || !maxHits || ray.mDirection * ray.mDirection == 0.0f || maxTime < 0.0f)
+			return 0;
+
+		ColliderBounds bounds;
+		ComputeRayBounds(ray.mOrigin, ray.mDirection, maxTime, &bounds);
+		QueryProxies(bounds, mask, [&](const BroadPhaseProxy & proxy)
+		{
+			RayCastHit hit;
+			hit.mCollider = proxy.mCollider;
+			hit.mTime = RayCastCollider(ray.mOrigin, ray.mDirection, proxy.mCollider);
+			if (hit.mTime < 0.0f || hit.mTime > maxTime)
+				return;
+			if (count == maxHits && !RayCastHitLess(hit, outHits[count - 1]))
+				return;
+			hit.mPoint = ray.mOrigin + ray.mDirection * hit.mTime;
+
+			// insertion in the sorted buffer (the last one falls off when full)
+			u32 i = count < maxHits ? count++ : count - 1;
+			for (; i > 0 && RayCastHitLess(hit, outHits[i - 1]); --i)
+				outHits[i] = outHits[i - 1];
+			outHits[i] = hit;
+		});
+		return count;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		RayCast
+	// \brief	Closest hit of each ray (outHits[i].mCollider is NULL when ray i
+	//			hits nothing). The rays go in groups of 4: the candidates are 
+	//			gathered once for the bounds of the group and their bounds are 
+	//			tested against the 4 rays at once (SSE slab test), only the rays
+	//			that pass it run the exact shape test.
+	// ----------------------------------------------------------------------------
+	u32 CollisionSystem::RayCast(const Ray * rays, u32 count, f32 maxTime, u32 mask, RayCastHit * outHits)
+	{
+		u32 hits = 0;
+		if (!rays || !outHits)
+			return 0;
+
+		for (u32 base = 0; base < count; base += 4)
+		{
+			const u32 lanes = (std::min)(count - base, 4u);
+
+			// lane data, the unused lanes can't hit anything (max time < 0)
+			alignas(16) f32 ox[4], oy[4], idx[4], idy[4], tmax[4];
+			ColliderBounds group;
+			bool anyRay = false;
+			for (u32 l = 0; l < 4; ++l)
+			{
+				ox[l] = oy[l] = idx[l] = idy[l] = 0.0f;
+				tmax[l] = -1.0f;
+				if (l >= lanes)
+					continue;
+
+				RayCastHit & hit = outHits[base + l];
+				hit.mCollider = NULL;
+				hit.mTime = maxTime;
+				const Ray & ray = rays[base + l];
+				if (ray.mDirection * ray.mDirection == 0.0f || maxTime < 0.0f)
+					continue;
+
+				// huge instead of infinite, so that 0 * inv doesn't give NaN
+				ox[l] = ray.mOrigin.x;
+				oy[l] = ray.mOrigin.y;
+				idx[l] = ray.mDirection.x != 0.0f ? 1.0f / ray.mDirection.x : 1e30f;
+				idy[l] = ray.mDirection.y != 0.0f ? 1.0f / ray.mDirection.y : 1e30f;
+				tmax[l] = maxTime;
+
+				ColliderBounds bounds;
+				ComputeRayBounds(ray.mOrigin, ray.mDirection, maxTime, &bounds);
+				if (!anyRay)
+					group = bounds;
+				anyRay = true;
+				group.mMin = AEVec2((std::min)(group.mMin.x, bounds.mMin.x), (std::min)(group.mMin.y, bounds.mMin.y));
+				group.mMax = AEVec2((std::max)(group.mMax.x, bounds.mMax.x), (std::max)(group.mMax.y, bounds.mMax.y));
+			}
+
+			if (!anyRay)
+				continue;
+
+			const __m128 vox = _mm_load_ps(ox), voy = _mm_load_ps(oy);
+			const __m128 vidx = _mm_load_ps(idx), vidy = _mm_load_ps(idy);
+			const __m128 zero = _mm_setzero_ps();
+
+			QueryProxies(group, mask, [&](const BroadPhaseProxy & proxy)
+			{
+				// slab test of the 4 rays against the bounds, up to their closest hit
+				const ColliderBounds & b = proxy.mBounds;
+				__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(b.mMin.x), vox), vidx);
+				__m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(b.mMax.x), vox), vidx);
+				__m128 t3 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(b.mMin.y), voy), vidy);
+				__m128 t4 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(b.mMax.y), voy), vidy);
+				__m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(t1, t2), _mm_min_ps(t3, t4)), zero);
+				__m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t1, t2), _mm_max_ps(t3, t4)), _mm_load_ps(tmax));
+				int laneMask = _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+
+				for (u32 l = 0; laneMask; ++l, laneMask >>= 1)
+				{
+					if (!(laneMask & 1))
+						continue;
+
+					RayCastHit & best = outHits[base + l];
+					RayCastHit hit;
+					hit.mCollider = proxy.mCollider;
+					hit.mTime = RayCastCollider(rays[base + l].mOrigin, rays[base + l].mDirection, proxy.mCollider);
+					if (hit.mTime < 0.0f || hit.mTime > best.mTime)
+						continue;
+					if (!best.mCollider || RayCastHitLess(hit, best))
+					{
+						best = hit;
+						tmax[l] = hit.mTime; // prunes the rest of the candidates of this ray
+					}
+				}
+			});
+
+			for (u32 l = 0; l < lanes; ++l)
+			{
+				RayCastHit & hit = outHits[base + l];
+				if (!hit.mCollider)
+					continue;
+				hit.mPoint = rays[base + l].mOrigin + rays[base + l].mDirection * hit.mTime;
+				hits++;
+			}
+		}
+		return hits;
+	}
+
+	// circle vs collider, boolean
+	static bool OverlapCircleCollider(AEVec2 center, f32 radius, Collider * body)
+	{
+		Transform & tr = body->mTransform->mLocal;
+		switch (body->mCollisionShape)
+		{
+		case CSHAPE_CIRCLE:
+			return StaticCircleToStaticCircle(&center, radius, &tr.mTranslation, tr.mScale.x);
+		case CSHAPE_OBB:
+			return OrientedRectToStaticCirlce(&tr.mTranslation, tr.mScale.x, tr.mScale.y, tr.mOrientation, &center, radius);
+		case CSHAPE_POLYGON:
+		{
+			const AEVec2 * vertices, * normals;
+			u32 vertexCount = GetColliderPolygon(body, NULL, NULL, &vertices, &normals);
+			return ConvexPolygonToCircleEx(vertices, normals, vertexCount, center, radius, NULL);
+		}
+		default:
+			return StaticRectToStaticCirlce(&tr.mTranslation, tr.mScale.x, tr.mScale.y, &center, radius);
+		}
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		OverlapCircle
+	// \brief	Colliders touching the circle (at most maxColliders of them).
+	// ----------------------------------------------------------------------------
+	u32 CollisionSystem::OverlapCircle(const AEVec2 & center, f32 radius, u32 mask, Collider ** outColliders, u32 maxColliders)
+	{
+		u32 count = 0;
+		if (!outColliders || !maxColliders)
+			return 0;
+
+		ColliderBounds bounds;
+		bounds.mMin = center - AEVec2(radius, radius);
+		bounds.mMax = center + AEVec2(radius, radius);
+		QueryProxies(bounds, mask, [&](const BroadPhaseProxy & proxy)
+		{
+			if (count < maxColliders && OverlapCircleCollider(center, radius, proxy.mCollider))
+				outColliders[count++] = proxy.mCollider;
+		});
+		return count;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		OverlapAABB
+	// \brief	Colliders touching the box [min, max] (at most maxColliders).
+	// ----------------------------------------------------------------------------
+	u32 CollisionSystem::OverlapAABB(const AEVec2 & min, const AEVec2 & max, u32 mask, Collider ** outColliders, u32 maxColliders)
+	{
+		u32 count = 0;
+		if (!outColliders || !maxColliders)
+			return 0;
+
+		ColliderBounds bounds;
+		bounds.mMin = min;
+		bounds.mMax = max;
+		AEVec2 center = (min + max) * 0.5f;
+		AEVec2 size = max - min;
+		QueryProxies(bounds, mask, [&](const BroadPhaseProxy & proxy)
+		{
+			if (count == maxColliders)
+				return;
+
+			Collider * body = proxy.mCollider;
+			Transform & tr = body->mTransform->mLocal;
+			bool overlap;
+			switch (body->mCollisionShape)
+			{
+			case CSHAPE_CIRCLE:
+				overlap = StaticRectToStaticCirlce(&center, size.x, size.y, &tr.mTranslation, tr.mScale.x);
+				break;
+			case CSHAPE_OBB:
+			{
+				Transform box(center, size, 0.0f);
+				overlap = OrientedRectToOrientedRectEx(&box, &tr, NULL);
+				break;
+			}
+			case CSHAPE_POLYGON:
+			{
+				const AEVec2 boxVertices[4] = { min, AEVec2(max.x, min.y), max, AEVec2(min.x, max.y) };
+				const AEVec2 boxNormals[4] = { AEVec2(0.0f, -1.0f), AEVec2(1.0f, 0.0f), AEVec2(0.0f, 1.0f), AEVec2(-1.0f, 0.0f) };
+				const AEVec2 * vertices, * normals;
+				u32 vertexCount = GetColliderPolygon(body, NULL, NULL, &vertices, &normals);
+				overlap = ConvexPolygonsEx(boxVertices, boxNormals, 4, vertices, normals, vertexCount, NULL);
+				break;
+			}
+			default:
+				overlap = true; // the bounds are the box
+				break;
+			}
+			if (overlap)
+				outColliders[count++] = body;
+		});
+		return count;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		CircleCast
+	// \brief	First collider hit by a circle moving from center to center + 
+	//			motion (same sweep as the continuous collision). mTime is a 
+	//			factor of motion and mPoint the center of the circle at impact.
+	// ----------------------------------------------------------------------------
+	bool CollisionSystem::CircleCast(const AEVec2 & center, f32 radius, const AEVec2 & motion, u32 mask, RayCastHit * outHit)
+	{
+		RayCastHit best;
+		best.mCollider = NULL;
+		best.mTime = 1.0f;
+
+		ColliderBounds bounds;
+		ComputeRayBounds(center, motion, 1.0f, &bounds);
+		bounds.mMin -= AEVec2(radius, radius);
+		bounds.mMax += AEVec2(radius, radius);
+		QueryProxies(bounds, mask, [&](const BroadPhaseProxy & proxy)
+		{
+			RayCastHit hit;
+			hit.mCollider = proxy.mCollider;
+			if (OverlapCircleCollider(center, radius, proxy.mCollider))
+				hit.mTime = 0.0f;
+			else if (motion * motion > 0.0f)
+				hit.mTime = SweepCircleAgainst(center, motion, radius, proxy.mCollider);
+			else
+				return;
+			if (hit.mTime < 0.0f || hit.mTime > best.mTime)
+				return;
+			if (!best.mCollider || RayCastHitLess(hit, best))
+				best = hit;
+		});
+
+		if (!best.mCollider)
+			return false;
+		best.mPoint = center + motion * best.mTime;
+		if (outHit)
+			*outHit = best;
+		return true;
 	}
-	//------------------------------------------------
 
 	#pragma endregion
 	// ----------------------------------------------------------------------------
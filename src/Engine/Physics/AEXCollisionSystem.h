@@ -4,33 +4,218 @@
 #include "../Math/Collisions.h"
 #include "../Math/ContactCollisions.h"
 #include "src\Engine\Components\AEXCollider.h"
+#include "AEXWorkerPool.h"
+#include "AEXContactSolver.h"
+#include <unordered_map>
+#include <functional>
 
 // Collision restitution for velocity resolution
-#define DFLT_RESTITUTION 0.908f;
+#define DFLT_RESTITUTION 0.908f
+
+// Number of collision layers (bits of Collider::mCategory)
+#define COLLISION_LAYER_MAX 32
+
+// CollisionEvents the event bus can hold between two dispatches
+#define COLLISION_EVENT_CAPACITY 8192
 
 namespace AEX
 {
+	struct Ray;
+
 	bool CollideCircles(Collider* body1, Collider* body2, Contact * c);
 	bool CollideAABBs(Collider* body1, Collider* body2, Contact * c);
 	bool CollideOBBs(Collider* body1, Collider* body2, Contact * c);
 	bool CollideAABBToCircle(Collider* body1, Collider* body2, Contact * c);
 	bool CollideOBBToCircle(Collider* body1, Collider* body2, Contact * c);
+	bool CollidePolygons(Collider* body1, Collider* body2, Contact * c);		// polygon vs polygon/AABB/OBB
+	bool CollidePolygonToCircle(Collider* body1, Collider* body2, Contact * c);
 
 	// typedef for function pointer CollisionFn
 	typedef bool(*CollisionFn)(Collider*, Collider*, Contact *);
 
+	// World space bounds used by the broadphase
+	struct ColliderBounds
+	{
+		AEVec2 mMin;
+		AEVec2 mMax;
+	};
+
+	// Broadphase entry: a collider and its bounds for this step
+	struct BroadPhaseProxy
+	{
+		ColliderBounds	mBounds;
+		Collider *	mCollider;
+	};
+
+	// Node of the bounding volume tree of the static bodies. Stored depth 
+	// first, so the first child of an inner node is the next node.
+	struct StaticTreeNode
+	{
+		ColliderBounds	mBounds;
+		u32				mIndex;		// leaf: first static proxy. Inner: second child
+		u32				mCount;		// leaf: number of proxies. Inner: 0
+	};
+
+	// Broadphase output: two colliders whose bounds overlap.
+	struct ColliderPair
+	{
+		Collider *	mBody1;
+		Collider *	mBody2;
+		u64			mKey;	// see MakePairKey
+	};
+
+	// Narrowphase output: a pair that is actually touching.
+	struct ContactPair
+	{
+		Collider *	mBody1;
+		Collider *	mBody2;
+		u64			mKey;
+		Contact		mContact;
+	};
+
+	// Order independent key for a pair of colliders (lowest id in the high bits).
+	inline u64 MakePairKey(const Collider * body1, const Collider * body2)
+	{
+		u64 id1 = body1->mColliderID, id2 = body2->mColliderID;
+		return id1 < id2 ? (id1 << 32) | id2 : (id2 << 32) | id1;
+	}
+
+	// FNV-1a of 'size' bytes, continuing 'hash' (start with AEX_HASH_SEED). 
+	// Used by the checksums of the deterministic mode.
+	#define AEX_HASH_SEED 14695981039346656037ull
+	inline u64 HashBytes(u64 hash, const void * data, u32 size)
+	{
+		const u8 * bytes = static_cast<const u8 *>(data);
+		for (u32 i = 0; i < size; ++i)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	// Transition of a pair of colliders in a step.
+	enum ECollisionEvent
+	{
+		CEVENT_BEGIN,	// started touching this step
+		CEVENT_STAY,	// touching this step and the previous one
+		CEVENT_END		// touched the previous step, not anymore
+	};
+
+	// Reported after the step, ghosts included. mContact is not valid for
+	// CEVENT_END. Colliders removed from the system don't get CEVENT_END.
+	struct CollisionEvent
+	{
+		ECollisionEvent	mType;
+		Collider *		mBody1;
+		Collider *		mBody2;
+		u64				mKey;
+		Contact			mContact;
+	};
+
+	// Receives all the events of a step at once, sorted by pair key.
+	typedef std::function<void(const std::vector<CollisionEvent> &)> CollisionEventFn;
+
+	// Scene query result.
+	struct RayCastHit
+	{
+		Collider *	mCollider;	// NULL if nothing was hit
+		f32			mTime;		// as a factor of the ray direction (0 if it starts inside)
+		AEVec2		mPoint;
+	};
+
+	// Bodies connected by contacts. Islands don't share any movable body, so 
+	// each one can be solved (and put to sleep) independently.
+	struct ContactIsland
+	{
+		u32		mBodyBegin;			// range in the island bodies
+		u32		mBodyCount;
+		u32		mConstraintBegin;	// range in the constraints
+		u32		mConstraintCount;
+		bool	mbAwake;
+	};
+
+	// Dynamic collider with a RigidBody and finite mass (the solver can move it).
+	bool IsMovableBody(const Collider * body);
+	// Movable and not sleeping.
+	bool IsAwakeBody(const Collider * body);
+	// Dynamic and not sleeping. Only movable bodies sleep, the dynamic ones
+	// with no mass (kinematic, moved by gameplay) are always active.
+	bool IsActiveBody(const Collider * body);
+
+	// Collision filter, both colliders have to accept each other. Uses 
+	// Collider::mFilterMask (see CollisionSystem::UpdateFilterMasks).
+	inline bool CanCollide(const Collider * body1, const Collider * body2)
+	{
+		return (body1->mCategory & body2->mFilterMask) && (body2->mCategory & body1->mFilterMask);
+	}
+
+	// Convex polygon of the collider in world space (cached one of the polygons,
+	// the boxes are written to the 4 element scratch arrays). Returns the count.
+	u32 GetColliderPolygon(Collider * body, AEVec2 * boxVertices, AEVec2 * boxNormals, const AEVec2 ** outVertices, const AEVec2 ** outNormals);
+
+	// Radius of the circle inside the collider, used as its shape for the CCD.
+	f32 ComputeCCDRadius(const Collider * body);
+
+	// Computes the world space bounds of the collider (from its cached transform).
+	void ComputeColliderBounds(Collider * body, ColliderBounds * out);
+
+	// Phases of CollisionSystem::CollideAllBodies, timed in mPhaseTimes.
+	enum ECollisionPhase
+	{
+		CPHASE_PREPARE,		// components, filter masks and static proxies
+		CPHASE_CONTINUOUS,
+		CPHASE_BROAD,
+		CPHASE_NARROW,
+		CPHASE_EVENTS,		// UpdateEvents + DispatchEvents
+		CPHASE_MANIFOLDS,
+		CPHASE_ISLANDS,
+		CPHASE_SOLVE,
+		CPHASE_COUNT
+	};
+	const char * GetCollisionPhaseName(u32 phase);
+
 	struct CollisionSystem : public ISystem
 	{
 		AEX_RTTI_DECL(CollisionSystem, ISystem);
 		AEX_SINGLETON(CollisionSystem);
+	public:
 		// ------------------------------------------------------------------------
 		// Member Variables
 		std::list<Collider*> mStaticBodies;
 		std::list<Collider*> mDynamicBodies;
 
-		// Collision iterations
-		u32 mCollisionIterations;
-		u32 mCollisionsThisFrame; // collisions this frame
+		// Contact solver
+		ContactSolverSettings mSolverSettings;
+		f32 mWarmStartNormalTolerance;	// min cos(angle) between normals to keep the cached impulse
+		u32 mCollisionsThisFrame; // solved contacts this frame
+
+		// Islands and sleeping
+		bool mbAllowSleeping;
+		f32 mTimeStep;				// length of a step, advances the sleep timers
+		f32 mSleepLinearTolerance;	// bodies slower than this (and the angular one)...
+		f32 mSleepAngularTolerance;
+		f32 mTimeToSleep;			// ...for this long fall asleep with their island
+		u32 mActiveBodies;
+		u32 mSleepingBodies;
+		u32 mActiveIslands;
+		u32 mSleepingIslands;
+
+		// Continuous collision (bullets and fast bodies against static bodies)
+		bool mbContinuousCollision;
+		f32 mCCDMotionThreshold;	// bodies moving more than this times their CCD radius use CCD
+		u32 mCCDBodiesThisFrame;
+		u32 mTOIHitsThisFrame;
+
+		// Layer matrix: mLayerMatrix[i] has bit j set if layer i collides with 
+		// layer j. Symmetric, everything collides with everything by default.
+		u32 mLayerMatrix[COLLISION_LAYER_MAX];
+
+		// Narrowphase threading
+		u32 mNarrowPhaseGrain;	// pairs per job chunk
+		u32 mPairsThisFrame;	// broadphase pairs of the last iteration
+
+		// Profiling: seconds spent in each phase (ECollisionPhase), accumulated
+		// over the steps since the last ResetPhaseTimes.
+		f64 mPhaseTimes[CPHASE_COUNT];
+		void ResetPhaseTimes();
 
 								  // Collision Tests -They are added to the collision system at initialize. 
 								  // (see CollisionSystem::Init) for more details.
@@ -49,18 +234,112 @@ namespace AEX
 		void RemoveRigidBody(Collider *obj);
 		void ClearBodies();
 
+		// Number of threads used by the narrowphase (including the main thread).
+		// 0 means hardware concurrency. Results don't depend on this value.
+		void SetThreadCount(u32 threadCount);
+		u32  GetThreadCount() const { return mWorkers.GetThreadCount(); }
+		WorkerPool & GetWorkers() { return mWorkers; }	// shared with the PhysicsSystem
+
+		// Layer matrix
+		void SetLayerCollision(u32 layer1, u32 layer2, bool collide);
+		bool GetLayerCollision(u32 layer1, u32 layer2) const;
+		void ResetLayerMatrix();
+
 		// findeing the collision tests
 		CollisionFn GetCollisionFn(Collider * b1, Collider * b2);
 
 		// Collides and resolve all rigidbodies 
 		void CollideAllBodies();
 
-		// Exposed solver
-		void ResolveContactPenetration(Collider * obj1, Collider * obj2, Contact * contact);
-		void ResolveContactVelocity(Collider * obj1, Collider * obj2, Contact * contact);
+		// Collision pipeline
+		void CacheBodyComponents();	// resolves Collider::mTransform/mRigidBody
+		void UpdateFilterMasks();	// Collider::mMask & layer matrix -> Collider::mFilterMask
+		void UpdateStaticProxies();	// rebuilds the static tree if the static bodies changed
+		void ContinuousPhase();		// moves the CCD bodies back to their time of impact
+		void BroadPhase();			// fills mPairs
+		void NarrowPhase();			// fills mContacts from mPairs, sorted by key
+
+		void UpdateEvents();		// mContacts -> mActivePairs transitions in mEvents
+		void DispatchEvents();		// mEvents -> listeners
+		void UpdateManifolds();		// mContacts -> mManifolds
+		void BuildIslands();		// mManifolds -> mConstraints grouped in mIslands, wakes islands up
+		void SolveIslands();		// solves the awake islands on the workers, puts islands to sleep
+
+		// Collision events
+		u32  AddEventListener(const CollisionEventFn & fn);	// returns the id for RemoveEventListener
+		void RemoveEventListener(u32 id);
+		const std::vector<CollisionEvent> & GetEvents() const { return mEvents; }	// last step's batch
+		u32  GetActivePairCount() const { return mActivePairs.size(); }
+
+		// Scene queries. Only the colliders whose mCategory is in 'mask' are 
+		// tested (ghosts included). The results are written to the buffers of 
+		// the caller, nothing is allocated. Main thread only, between steps.
+		bool RayCastClosest(const Ray & ray, f32 maxTime, u32 mask, RayCastHit * outHit);
+		u32  RayCastAll(const Ray & ray, f32 maxTime, u32 mask, RayCastHit * outHits, u32 maxHits);	// closest maxHits, sorted
+		u32  RayCast(const Ray * rays, u32 count, f32 maxTime, u32 mask, RayCastHit * outHits);	// closest hit of each ray, returns the hit count
+		u32  OverlapCircle(const AEVec2 & center, f32 radius, u32 mask, Collider ** outColliders, u32 maxColliders);
+		u32  OverlapAABB(const AEVec2 & min, const AEVec2 & max, u32 mask, Collider ** outColliders, u32 maxColliders);
+		bool CircleCast(const AEVec2 & center, f32 radius, const AEVec2 & motion, u32 mask, RayCastHit * outHit);
+
+		const std::vector<ContactPair> & GetContacts() const { return mContacts; }
+		u32 GetManifoldCount() const { return mManifolds.size(); }
+
+		// Hash of the persistent contacts (keys, contacts and accumulated 
+		// impulses). Doesn't depend on the order of the manifold map.
+		u64 ComputeContactChecksum() const;
+
+	private:
+		u32								mNextColliderID;
+		WorkerPool						mWorkers;
+		std::vector<BroadPhaseProxy>	mDynamicProxies;
+		f32								mDynamicMaxWidth;	// widest dynamic proxy, bounds the sweep
+
+		// static bodies: rarely change, so they get a tree that is only rebuilt
+		// when one is added, removed or moved
+		u32  BuildStaticTree(u32 begin, u32 end);
+		template <typename Fn> void QueryStaticTree(const ColliderBounds & bounds, Fn fn);
+		std::vector<BroadPhaseProxy>	mStaticProxies;		// in leaf order
+		std::vector<StaticTreeNode>		mStaticTree;
+		std::vector<u32>				mStaticVersions;	// TransformComp::GetVersion of mStaticBodies when the tree was built
+		bool							mbStaticDirty;		// static bodies added or removed
+		std::vector<ColliderPair>		mPairs;
+		std::vector<std::vector<ContactPair> >	mThreadContacts;	// one buffer per worker
+		std::vector<ContactPair>		mContacts;
+
+		// persistent contacts, keyed by MakePairKey
+		std::unordered_map<u64, ContactManifold>	mManifolds;
+		std::vector<ContactConstraint>	mConstraints;		// sorted by island, then by key
+		std::vector<ContactConstraint>	mSortedConstraints;	// scratch
+		u32								mStepCount;
+
+		// touching pairs (ghosts included), keyed by MakePairKey
+		struct ActivePair
+		{
+			Collider *	mBody1;
+			Collider *	mBody2;
+			u32			mLastFrame;
+		};
+		std::unordered_map<u64, ActivePair>		mActivePairs;
+		std::vector<CollisionEvent>				mEvents;
+		std::vector<std::pair<u32, CollisionEventFn> >	mEventListeners;
+		u32										mNextListenerID;
+
+		// scene queries use the broadphase proxies
+		void UpdateQueryProxies();
+		template <typename Fn> void QueryProxies(const ColliderBounds & bounds, u32 mask, Fn fn);
+		bool							mbQueryDynamicDirty;	// the dynamic bounds are from before the solver
+
+		// islands
+		void SolveIsland(const ContactIsland & island);
+		std::vector<Collider*>			mMovableBodies;		// indexed by Collider::mSolverIndex
+		std::vector<u32>				mIslandParent;		// union-find, the root is the lowest index
+		std::vector<u32>				mBodyIsland;
+		std::vector<Collider*>			mIslandBodies;		// sorted by island
+		std::vector<ContactIsland>		mIslands;
+		std::vector<u32>				mAwakeIslands;
+		AEVec2							mZeroVelocity;	// for the colliders without RigidBody
 	};
 
-	CollisionSystem::CollisionSystem() : ISystem() {}
 	// ---------------------------------------------------------------------------
 }
 
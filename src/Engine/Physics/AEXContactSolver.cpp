@@ -0,0 +1,109 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXContactSolver.cpp
+// Purpose:	Implementation of the sequential impulse contact solver.
+// ----------------------------------------------------------------------------
+#include "AEXContactSolver.h"
+#include "../Math/SimdMath.h"
+
+namespace AEX
+{
+	// the inner loops use the inline vectors, the AEVec2 operators are calls
+	// into aexmath.dll
+	using Simd::AsSimd;
+
+	// applies the impulse 'impulse' along n to both bodies
+	static void ApplyImpulse(ContactConstraint & c, f32 impulse)
+	{
+		Simd::Vec2 P = AsSimd(c.mNormal) * impulse;
+		if (c.mInvMass1)
+			AsSimd(*c.mVelocity1) -= P * c.mInvMass1;
+		if (c.mInvMass2)
+			AsSimd(*c.mVelocity2) += P * c.mInvMass2;
+	}
+
+	void SolveContactConstraints(ContactConstraint * constraints, u32 count, const ContactSolverSettings & settings)
+	{
+		// ------------------------------------------------------------------------
+		// prepare
+		for (u32 i = 0; i < count; ++i)
+		{
+			ContactConstraint & c = constraints[i];
+			ContactManifold * m = c.mManifold;
+
+			c.mNormal = m->mContact.mNormal;
+			c.mStartPosition1 = *c.mPosition1;
+			c.mStartPosition2 = *c.mPosition2;
+
+			f32 invMassSum = c.mInvMass1 + c.mInvMass2;
+			c.mNormalMass = invMassSum > 0.0f ? 1.0f / invMassSum : 0.0f;
+
+			// bounce only when approaching fast enough, resting contacts stay at rest
+			f32 vn = (AsSimd(*c.mVelocity2) - AsSimd(*c.mVelocity1)) * AsSimd(c.mNormal);
+			c.mVelocityBias = vn < -settings.mRestitutionThreshold ? -settings.mRestitution * vn : 0.0f;
+		}
+
+		// ------------------------------------------------------------------------
+		// warm start (after the bias, which must see the velocities before any impulse)
+		for (u32 i = 0; i < count; ++i)
+		{
+			ContactConstraint & c = constraints[i];
+			if (settings.mbWarmStarting)
+				ApplyImpulse(c, c.mManifold->mNormalImpulse);
+			else
+				c.mManifold->mNormalImpulse = 0.0f;
+		}
+
+		// ------------------------------------------------------------------------
+		// velocity constraints
+		for (u32 it = 0; it < settings.mVelocityIterations; ++it)
+		{
+			for (u32 i = 0; i < count; ++i)
+			{
+				ContactConstraint & c = constraints[i];
+				ContactManifold * m = c.mManifold;
+
+				f32 vn = (AsSimd(*c.mVelocity2) - AsSimd(*c.mVelocity1)) * AsSimd(c.mNormal);
+				f32 lambda = -c.mNormalMass * (vn - c.mVelocityBias);
+
+				// clamp the accumulated impulse, not the increment
+				f32 newImpulse = m->mNormalImpulse + lambda;
+				if (newImpulse < 0.0f)
+					newImpulse = 0.0f;
+				lambda = newImpulse - m->mNormalImpulse;
+				m->mNormalImpulse = newImpulse;
+
+				ApplyImpulse(c, lambda);
+			}
+		}
+
+		// ------------------------------------------------------------------------
+		// position correction
+		for (u32 it = 0; it < settings.mPositionIterations; ++it)
+		{
+			for (u32 i = 0; i < count; ++i)
+			{
+				ContactConstraint & c = constraints[i];
+				if (c.mNormalMass == 0.0f)
+					continue;
+
+				// current penetration = detected one - how much the bodies moved apart since
+				Simd::Vec2 d1 = AsSimd(*c.mPosition1) - AsSimd(c.mStartPosition1);
+				Simd::Vec2 d2 = AsSimd(*c.mPosition2) - AsSimd(c.mStartPosition2);
+				f32 penetration = c.mManifold->mContact.mPenetration - (d2 - d1) * AsSimd(c.mNormal);
+
+				f32 correction = settings.mBaumgarte * (penetration - settings.mLinearSlop);
+				if (correction <= 0.0f)
+					continue;
+				if (correction > settings.mMaxCorrection)
+					correction = settings.mMaxCorrection;
+
+				Simd::Vec2 P = AsSimd(c.mNormal) * (correction * c.mNormalMass);
+				if (c.mInvMass1)
+					AsSimd(*c.mPosition1) -= P * c.mInvMass1;
+				if (c.mInvMass2)
+					AsSimd(*c.mPosition2) += P * c.mInvMass2;
+			}
+		}
+	}
+}
@@ -0,0 +1,78 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXContactSolver.h
+// Purpose:	Sequential impulse contact solver. Contacts are kept in persistent
+//			manifolds (keyed by collider pair) so the impulses of the last
+//			step can warm start the next one.
+// ----------------------------------------------------------------------------
+#ifndef AEX_CONTACT_SOLVER_H_
+#define AEX_CONTACT_SOLVER_H_
+
+#include "../Math/ContactCollisions.h"
+#include "src\Engine\Components\AEXCollider.h"
+
+namespace AEX
+{
+	// ----------------------------------------------------------------------------
+	// \struct	ContactManifold
+	// \brief	Contact between two colliders that survives across steps while the
+	//			pair keeps touching.
+	struct ContactManifold
+	{
+		Collider *	mBody1;
+		Collider *	mBody2;
+		Contact		mContact;
+		u64			mKey;			// see MakePairKey
+		f32			mNormalImpulse;	// accumulated impulse (>= 0), warm starts the next step
+		u32			mLastFrame;		// last step in which the pair was touching
+	};
+
+	// ----------------------------------------------------------------------------
+	// \struct	ContactConstraint
+	// \brief	Per step solver data of a manifold. Body data is accessed through
+	//			pointers, writes only happen on bodies with inverse mass > 0.
+	struct ContactConstraint
+	{
+		ContactManifold *	mManifold;
+		AEVec2 *			mVelocity1;
+		AEVec2 *			mVelocity2;
+		AEVec2 *			mPosition1;
+		AEVec2 *			mPosition2;
+		f32					mInvMass1;
+		f32					mInvMass2;
+
+		// set by the solver
+		AEVec2				mNormal;
+		AEVec2				mStartPosition1;	// positions when the contact was detected
+		AEVec2				mStartPosition2;
+		f32					mNormalMass;		// 1 / (invMass1 + invMass2)
+		f32					mVelocityBias;		// restitution target
+	};
+
+	// ----------------------------------------------------------------------------
+	// \struct	ContactSolverSettings
+	struct ContactSolverSettings
+	{
+		u32		mVelocityIterations;
+		u32		mPositionIterations;
+		f32		mRestitution;
+		f32		mRestitutionThreshold;	// slower approaching contacts don't bounce
+		f32		mBaumgarte;				// fraction of the penetration fixed per position iteration
+		f32		mLinearSlop;			// allowed penetration, avoids jitter on resting contacts
+		f32		mMaxCorrection;			// max position correction per iteration
+		bool	mbWarmStarting;
+	};
+
+	//! ---------------------------------------------------------------------------
+	// \fn		SolveContactConstraints
+	// \brief	Warm starts, iterates the velocity constraints and then corrects the
+	//			positions (split from the velocities, so it doesn't add energy).
+	//			The constraints are not re-detected: the penetration is updated
+	//			from the displacement of the bodies along the contact normal.
+	//			The accumulated impulses are stored back in the manifolds.
+	// ---------------------------------------------------------------------------
+	void SolveContactConstraints(ContactConstraint * constraints, u32 count, const ContactSolverSettings & settings);
+}
+
+// ----------------------------------------------------------------------------
+#endif
@@ -0,0 +1,377 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXPhysicsSystem.cpp
+// Purpose:	Implementation of the fixed time step physics driver.
+// ----------------------------------------------------------------------------
+#include "AEXPhysicsSystem.h"
+#include "AEXCollisionSystem.h"
+#include "..\Platform\AEXTime.h"
+#include "src\Engine\Components\AEXComponents.h"
+#include <algorithm>	// std::max
+#include <float.h>		// _RC_NEAR...
+#include <xmmintrin.h>	// SSE
+
+namespace AEX
+{
+	// float state of the deterministic steps: round to nearest, IEEE denormals
+	// and (x87 code on x86) double precision. The defaults, but drivers and 
+	// other libraries are known to change them.
+#if defined(_M_IX86)
+	static const u32 cDeterministicFloatControl = _RC_NEAR | _DN_SAVE | _PC_53;
+#else
+	static const u32 cDeterministicFloatControl = _RC_NEAR | _DN_SAVE;
+#endif
+
+	PhysicsSystem::PhysicsSystem() : ISystem() {}
+
+	//!----------------------------------------------------------------------------
+	// \fn		Initialize
+	// \brief	Sets the defaults and initializes the CollisionSystem.
+	// ----------------------------------------------------------------------------
+	bool PhysicsSystem::Initialize()
+	{
+		mFixedTimeStep = 1.0f / 60.0f;
+		mMaxStepsPerFrame = 5;
+		mMaxSubSteps = 4;
+		mSubStepTravel = 0.5f;
+		mIntegrateGrain = 4096;
+
+		mAccumulator = 0.0f;
+		mAlpha = 0.0f;
+		mStepsThisFrame = 0;
+		mSubStepsLastStep = 0;
+
+		mbDeterministic = false;
+		mChecksum = 0;
+		mStepIndex = 0;
+
+		return CollisionSystem::Instance()->Initialize();
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		Update
+	// \brief	Advances the simulation by the duration of the last frame.
+	// ----------------------------------------------------------------------------
+	void PhysicsSystem::Update()
+	{
+		// the frame time would change the step in which the inputs are applied
+		if (mbDeterministic)
+		{
+			Step();
+			mStepsThisFrame = 1;
+			mAlpha = 1.0f;
+			return;
+		}
+
+		Advance(static_cast<f32>(aexTime->GetFrameTime()));
+	}
+
+	// moves the transforms of the bodies (the collisions run inside Update)
+	void PhysicsSystem::DeclareAccess(SystemAccess & access)
+	{
+		access.Write<TransformComp>().Write<RigidBody>().Write<Collider>();
+	}
+
+	void PhysicsSystem::Shutdown()
+	{
+		ClearBodies();
+		CollisionSystem::Instance()->Shutdown();
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		Advance
+	// \brief	Runs the fixed steps that fit in the accumulated time. At most
+	//			mMaxStepsPerFrame steps are run, if the frame was longer (e.g.
+	//			a breakpoint or a loading hitch) the extra time is dropped instead
+	//			of making the next frames even slower.
+	// ----------------------------------------------------------------------------
+	void PhysicsSystem::Advance(f32 frameTime)
+	{
+		mStepsThisFrame = 0;
+		if (mFixedTimeStep <= 0.0f)
+			return;
+
+		mAccumulator += frameTime;
+		while (mAccumulator >= mFixedTimeStep && mStepsThisFrame < mMaxStepsPerFrame)
+		{
+			Step();
+			mAccumulator -= mFixedTimeStep;
+			mStepsThisFrame++;
+		}
+
+		// too far behind, drop what can't be caught up
+		if (mAccumulator >= mFixedTimeStep)
+			mAccumulator = 0.0f;
+
+		mAlpha = mAccumulator / mFixedTimeStep;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		Step
+	// \brief	Saves the transforms for the interpolation and advances the
+	//			bodies and the collisions by mFixedTimeStep.
+	// ----------------------------------------------------------------------------
+	void PhysicsSystem::Step()
+	{
+		u32 floatControl = 0;
+		if (mbDeterministic)
+		{
+			floatControl = GetFloatControl();
+			SetFloatControl(cDeterministicFloatControl);
+		}
+
+		// the transforms are resolved in RigidBody::Initialize, only look up
+		// the missing ones
+		FOR_EACH(it, mBodies)
+		{
+			RigidBody * rb = *it;
+			if (!rb->mTransform && rb->mOwner)
+				rb->mTransform = GetTransByComp(rb);
+			if (rb->mTransform)
+				rb->mPrevious = rb->mTransform->mLocal;
+		}
+
+		mSubStepsLastStep = ComputeSubSteps();
+		const f32 subStep = mFixedTimeStep / mSubStepsLastStep;
+
+		CollisionSystem * collisions = CollisionSystem::Instance();
+		collisions->mTimeStep = subStep;
+		for (u32 i = 0; i < mSubStepsLastStep; ++i)
+		{
+			IntegrateBodies(subStep);
+			collisions->Update();
+		}
+
+		if (mbDeterministic)
+		{
+			mChecksum = ComputeChecksum();
+			mStepIndex++;
+			SetFloatControl(floatControl);
+		}
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		IntegrateBodies
+	// \brief	Same as calling RigidBody::Step on every body, in bulk: the bodies
+	//			are split in chunks (on the workers of the CollisionSystem), each
+	//			chunk integrates its bodies in blocks (see IntegrateRange).
+	// ----------------------------------------------------------------------------
+	void PhysicsSystem::IntegrateBodies(f32 timeStep)
+	{
+		const u32 count = static_cast<u32>(mBodies.size());
+		if (!count)
+			return;
+
+		const u32 grain = (std::max)(mIntegrateGrain, 1u);
+		CollisionSystem::Instance()->GetWorkers().ParallelFor(count, grain, [this, timeStep](u32, u32 begin, u32 end)
+		{
+			IntegrateRange(begin, end, timeStep);
+		});
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		IntegrateRange
+	// \brief	The bodies that move are gathered in SoA blocks of INTEGRATE_BLOCK
+	//			on the stack, integrated 4 at a time with SSE and written back
+	//			right away. A gather of the whole range followed by a scatter
+	//			reads the components twice from memory (PhysicsBenchmark,
+	//			"integrator": slower than RigidBody::Step), a block stays in L1
+	//			and its components are still cached when it is written back.
+	// ----------------------------------------------------------------------------
+	void PhysicsSystem::IntegrateRange(u32 begin, u32 end, f32 timeStep)
+	{
+		f32 positionX[INTEGRATE_BLOCK], positionY[INTEGRATE_BLOCK];
+		f32 velocityX[INTEGRATE_BLOCK], velocityY[INTEGRATE_BLOCK];
+		f32 accelerationX[INTEGRATE_BLOCK], accelerationY[INTEGRATE_BLOCK];
+		f32 drag[INTEGRATE_BLOCK];
+		RigidBody * block[INTEGRATE_BLOCK];
+		u32 blockCount = 0;
+
+		const __m128 dt = _mm_set1_ps(timeStep);
+		for (u32 i = begin; i <= end; ++i)
+		{
+			// gather
+			if (i < end)
+			{
+				RigidBody * rb = mBodies[i];
+				if (!rb->mTransform)
+					continue;
+
+				// start of the CCD sweep
+				const AEVec2 & position = rb->mTransform->mLocal.mTranslation;
+				rb->mStepStart = position;
+
+				// sleeping bodies don't move
+				if (!rb->mbAwake)
+					continue;
+				rb->UpdateInvMass();
+				if (!rb->mInvMass)
+					continue;
+
+				// forces + gravity, as RigidBody::Step (AddForce(Gravity / mInvMass))
+				AEVec2 acceleration = rb->mAcceleration + rb->Gravity / rb->mInvMass;
+				acceleration *= rb->mInvMass;
+
+				block[blockCount] = rb;
+				positionX[blockCount] = position.x;
+				positionY[blockCount] = position.y;
+				velocityX[blockCount] = rb->Velocity.x;
+				velocityY[blockCount] = rb->Velocity.y;
+				accelerationX[blockCount] = acceleration.x;
+				accelerationY[blockCount] = acceleration.y;
+				drag[blockCount] = rb->LinearDrag;
+				if (++blockCount < INTEGRATE_BLOCK)
+					continue;
+			}
+			if (!blockCount)
+				continue;
+
+			// the last lanes of a partial block integrate zeros
+			const u32 lanes = (blockCount + 3) & ~3u;
+			for (u32 b = blockCount; b < lanes; ++b)
+			{
+				positionX[b] = positionY[b] = 0.0f;
+				velocityX[b] = velocityY[b] = 0.0f;
+				accelerationX[b] = accelerationY[b] = 0.0f;
+				drag[b] = 1.0f;
+			}
+
+			// symplectic Euler, 4 bodies at a time (same operations as RigidBody::Integrate)
+			for (u32 b = 0; b < lanes; b += 4)
+			{
+				__m128 d = _mm_loadu_ps(&drag[b]);
+				__m128 vx = _mm_loadu_ps(&velocityX[b]);
+				__m128 vy = _mm_loadu_ps(&velocityY[b]);
+				vx = _mm_mul_ps(_mm_add_ps(vx, _mm_mul_ps(_mm_loadu_ps(&accelerationX[b]), dt)), d);
+				vy = _mm_mul_ps(_mm_add_ps(vy, _mm_mul_ps(_mm_loadu_ps(&accelerationY[b]), dt)), d);
+				_mm_storeu_ps(&velocityX[b], vx);
+				_mm_storeu_ps(&velocityY[b], vy);
+				_mm_storeu_ps(&positionX[b], _mm_add_ps(_mm_loadu_ps(&positionX[b]), _mm_mul_ps(vx, dt)));
+				_mm_storeu_ps(&positionY[b], _mm_add_ps(_mm_loadu_ps(&positionY[b]), _mm_mul_ps(vy, dt)));
+			}
+
+			// scatter
+			for (u32 b = 0; b < blockCount; ++b)
+			{
+				RigidBody * rb = block[b];
+				rb->Velocity = AEVec2(velocityX[b], velocityY[b]);
+				rb->mTransform->mLocal.mTranslation = AEVec2(positionX[b], positionY[b]);
+				rb->mAcceleration = AEVec2();
+			}
+			blockCount = 0;
+		}
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		ComputeSubSteps
+	// \brief	Number of substeps so that no awake body moves more than
+	//			mSubStepTravel times its smallest dimension in one of them.
+	// ----------------------------------------------------------------------------
+	u32 PhysicsSystem::ComputeSubSteps() const
+	{
+		u32 subSteps = 1;
+		FOR_EACH(it, mBodies)
+		{
+			const RigidBody * rb = *it;
+			if (!rb->IsAwake() || !rb->mTransform)
+				continue;
+
+			const AEVec2 & scale = rb->mTransform->mLocal.mScale;
+			f32 size = fabsf(scale.x) < fabsf(scale.y) ? fabsf(scale.x) : fabsf(scale.y);
+			f32 maxTravel = size * mSubStepTravel;
+			if (maxTravel <= 0.0f)
+				continue;
+
+			f32 travel = sqrtf(rb->Velocity * rb->Velocity) * mFixedTimeStep;
+			u32 needed = static_cast<u32>(ceilf(travel / maxTravel));
+			if (needed > subSteps)
+				subSteps = needed;
+			if (subSteps >= mMaxSubSteps)
+				break;
+		}
+		return subSteps < mMaxSubSteps ? subSteps : (mMaxSubSteps ? mMaxSubSteps : 1);
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		SetDeterministic
+	// \brief	Turns the deterministic mode on or off. Turning it on resets the
+	//			accumulated time and the step index.
+	// ----------------------------------------------------------------------------
+	void PhysicsSystem::SetDeterministic(bool deterministic)
+	{
+		if (deterministic && !mbDeterministic)
+		{
+			mAccumulator = 0.0f;
+			mStepIndex = 0;
+			mChecksum = ComputeChecksum();
+		}
+		mbDeterministic = deterministic;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		ComputeChecksum
+	// \brief	Hash of everything the next step depends on: the state of the
+	//			bodies in registration order and the persistent contacts. Bodies
+	//			are hashed by value, never by address.
+	// ----------------------------------------------------------------------------
+	u64 PhysicsSystem::ComputeChecksum() const
+	{
+		u64 hash = AEX_HASH_SEED;
+		FOR_EACH(it, mBodies)
+		{
+			const RigidBody * rb = *it;
+			if (rb->mTransform)
+			{
+				const Transform & tr = rb->mTransform->mLocal;
+				hash = HashBytes(hash, &tr.mTranslation, sizeof(AEVec2));
+				hash = HashBytes(hash, &tr.mOrientation, sizeof(f32));
+			}
+			hash = HashBytes(hash, &rb->Velocity, sizeof(AEVec2));
+			hash = HashBytes(hash, &rb->AngularVelocity, sizeof(f32));
+			hash = HashBytes(hash, &rb->mAcceleration, sizeof(AEVec2));
+			hash = HashBytes(hash, &rb->mbAwake, sizeof(bool));
+			hash = HashBytes(hash, &rb->mSleepTime, sizeof(f32));
+		}
+
+		u64 contacts = CollisionSystem::Instance()->ComputeContactChecksum();
+		return HashBytes(hash, &contacts, sizeof(contacts));
+	}
+
+	// ----------------------------------------------------------------------------
+	// Rigid Body Management
+	void PhysicsSystem::AddRigidBody(RigidBody * body)
+	{
+		if (body->mPhysicsIndex < mBodies.size() && mBodies[body->mPhysicsIndex] == body)
+			return; // no duplicates
+		body->mPhysicsIndex = static_cast<u32>(mBodies.size());
+		mBodies.push_back(body);
+	}
+	void PhysicsSystem::RemoveRigidBody(RigidBody * body)
+	{
+		const u32 index = body->mPhysicsIndex;
+		if (index >= mBodies.size() || mBodies[index] != body)
+			return;
+
+		if (mbDeterministic)
+		{
+			// the checksum hashes the bodies in registration order
+			mBodies.erase(mBodies.begin() + index);
+			for (u32 i = index; i < mBodies.size(); ++i)
+				mBodies[i]->mPhysicsIndex = i;
+		}
+		else
+		{
+			// the order doesn't matter, every body integrates on its own
+			mBodies[index] = mBodies.back();
+			mBodies[index]->mPhysicsIndex = index;
+			mBodies.pop_back();
+		}
+		body->mPhysicsIndex = 0xFFFFFFFF;
+	}
+	void PhysicsSystem::ClearBodies()
+	{
+		FOR_EACH(it, mBodies)
+			(*it)->mPhysicsIndex = 0xFFFFFFFF;
+		mBodies.clear();
+	}
+}
@@ -0,0 +1,96 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXPhysicsSystem.h
+// Purpose:	Fixed time step driver of the physics (RigidBody integration and
+//			CollisionSystem), independent of the frame rate.
+// ----------------------------------------------------------------------------
+#ifndef AEX_PHYSICS_SYSTEM_H_
+#define AEX_PHYSICS_SYSTEM_H_
+
+#include "..\Core\AEXCore.h"
+
+namespace AEX
+{
+	struct RigidBody;
+
+	// ----------------------------------------------------------------------------
+	// \class	PhysicsSystem
+	// \brief	The frame time is accumulated and consumed in steps of
+	//			mFixedTimeStep, so the simulation is the same at any frame rate.
+	//			The remainder is exposed as an interpolation factor between the
+	//			previous and the current transform of the bodies (see
+	//			RigidBody::GetInterpolatedTransform).
+	class PhysicsSystem : public ISystem
+	{
+		AEX_RTTI_DECL(PhysicsSystem, ISystem);
+		AEX_SINGLETON(PhysicsSystem);
+
+	public:
+		// ------------------------------------------------------------------------
+		// Settings
+		f32 mFixedTimeStep;		// simulated time per step
+		u32 mMaxStepsPerFrame;	// catch-up clamp, the rest of the time is dropped
+		u32 mMaxSubSteps;		// 1 disables substepping
+		f32 mSubStepTravel;		// fraction of its size a body may move in a substep
+		u32 mIntegrateGrain;	// bodies per integration job
+
+		// ------------------------------------------------------------------------
+		// System Functions
+		virtual bool Initialize();
+		virtual void Update();		// Advance(FRC frame time)
+		virtual void DeclareAccess(SystemAccess & access);
+		void Shutdown();
+
+		// Accumulates frameTime and runs as many fixed steps as fit.
+		void Advance(f32 frameTime);
+		// One fixed step (split in substeps when bodies move fast).
+		void Step();
+		// Gravity + integration of all the awake bodies (see RigidBody::Step).
+		void IntegrateBodies(f32 timeStep);
+
+		// Rigid Body Management
+		void AddRigidBody(RigidBody * body);
+		void RemoveRigidBody(RigidBody * body);
+		void ClearBodies();
+
+		// [0, 1] position of the frame between the last two steps (1 in the
+		// deterministic mode, the frame is the last step)
+		f32 GetInterpolationAlpha() const { return mAlpha; }
+		u32 GetStepsThisFrame() const { return mStepsThisFrame; }
+		u32 GetSubStepsLastStep() const { return mSubStepsLastStep; }
+
+		// Deterministic mode (lockstep, replays). Update runs exactly one step
+		// whatever the frame time, the bodies stay in registration order, the
+		// steps run with a fixed floating-point state (on the workers too) and
+		// a checksum of the world is computed after each step. The same inputs
+		// on the same build give the same checksum sequence.
+		void SetDeterministic(bool deterministic);
+		bool IsDeterministic() const { return mbDeterministic; }
+		u64  GetChecksum() const { return mChecksum; }		// after the last step
+		u32  GetStepIndex() const { return mStepIndex; }	// steps since SetDeterministic(true)
+		u64  ComputeChecksum() const;	// bodies (in order) + persistent contacts
+
+	private:
+		static const u32 INTEGRATE_BLOCK = 64;	// bodies per SoA block of IntegrateRange, a multiple of 4
+
+		u32 ComputeSubSteps() const;
+		void IntegrateRange(u32 begin, u32 end, f32 timeStep);
+
+		std::vector<RigidBody*>	mBodies;	// RigidBody::mPhysicsIndex is the index here
+
+		f32						mAccumulator;
+		f32						mAlpha;
+		u32						mStepsThisFrame;
+		u32						mSubStepsLastStep;
+
+		bool					mbDeterministic;
+		u64						mChecksum;
+		u32						mStepIndex;
+	};
+}
+
+// Easy access to singleton
+#define aexPhysics (AEX::PhysicsSystem::Instance())
+// ---------------------------------------------------------------------------
+
+#endif
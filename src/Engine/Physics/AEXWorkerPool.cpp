@@ -0,0 +1,118 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXWorkerPool.cpp
+// Purpose:	Implementation of the physics worker pool.
+// ----------------------------------------------------------------------------
+#include "AEXWorkerPool.h"
+#include "..\Utilities\AEXContainers.h"
+#include <float.h>	// _controlfp_s
+
+namespace AEX
+{
+	// bits of the control word that change the results of the float operations
+#if defined(_M_IX86)
+	static const u32 cFloatControlMask = _MCW_RC | _MCW_DN | _MCW_PC;
+#else
+	static const u32 cFloatControlMask = _MCW_RC | _MCW_DN;	// no x87 precision control on x64
+#endif
+
+	u32 GetFloatControl()
+	{
+		unsigned int control = 0;
+		_controlfp_s(&control, 0, 0);
+		return control & cFloatControlMask;
+	}
+
+	void SetFloatControl(u32 control)
+	{
+		unsigned int current = 0;
+		_controlfp_s(&current, control & cFloatControlMask, cFloatControlMask);
+	}
+
+	WorkerPool::WorkerPool()
+		: mThreadCount(1)
+	{}
+
+	WorkerPool::~WorkerPool()
+	{
+		Shutdown();
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		Initialize
+	// \brief	Sets the number of workers, starting the JobSystem if needed.
+	// ----------------------------------------------------------------------------
+	void WorkerPool::Initialize(u32 threadCount)
+	{
+		if (!aexJobs->IsRunning())
+			aexJobs->Initialize();
+
+		if (threadCount == 0)
+			threadCount = aexJobs->GetThreadCount();
+		mThreadCount = threadCount ? threadCount : 1;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		Shutdown
+	// \brief	Back to running inline. The threads belong to the JobSystem.
+	// ----------------------------------------------------------------------------
+	void WorkerPool::Shutdown()
+	{
+		mThreadCount = 1;
+	}
+
+	//!----------------------------------------------------------------------------
+	// \fn		ParallelFor
+	// \brief	Queues one job per extra worker, helps as worker 0 and waits for
+	//			the rest. The chunks are handed out in order by a shared counter,
+	//			so a worker whose job starts late just finds nothing left.
+	// ----------------------------------------------------------------------------
+	void WorkerPool::ParallelFor(u32 count, u32 grain, const RangeFn & fn)
+	{
+		if (count == 0)
+			return;
+		if (grain == 0)
+			grain = 1;
+
+		const u32 chunkCount = (count + grain - 1) / grain;
+		const u32 workers = mThreadCount < chunkCount ? mThreadCount : chunkCount;
+
+		// not worth waking anybody up
+		if (workers <= 1 || !aexJobs->IsRunning())
+		{
+			fn(0, 0, count);
+			return;
+		}
+
+		const u32 floatControl = GetFloatControl();
+		std::atomic<u32> nextChunk(0);
+		auto runChunks = [&](u32 worker)
+		{
+			for (u32 chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++)
+			{
+				u32 begin = chunk * grain;
+				u32 end = begin + grain < count ? begin + grain : count;
+				fn(worker, begin, end);
+			}
+		};
+
+		JobCounter counter;
+		for (u32 i = 1; i < workers; ++i)
+		{
+			aexJobs->Run([&runChunks, floatControl, i](u32)
+			{
+				// same float results as the calling thread
+				u32 previous = GetFloatControl();
+				if (previous != floatControl)
+					SetFloatControl(floatControl);
+				runChunks(i);
+				if (previous != floatControl)
+					SetFloatControl(previous);
+			}, &counter);
+		}
+
+		// the calling thread is worker 0
+		runChunks(0);
+		aexJobs->Wait(counter);
+	}
+}
@@ -0,0 +1,52 @@
+// ----------------------------------------------------------------------------
+// Project: GAM200 - Sample Engine
+// File:	AEXWorkerPool.h
+// Purpose:	Splits independent physics work (e.g. the narrowphase) in
+//			contiguous index ranges over a fixed number of workers. The
+//			threads are the ones of the JobSystem.
+// ----------------------------------------------------------------------------
+#ifndef AEX_WORKER_POOL_H_
+#define AEX_WORKER_POOL_H_
+
+#include "..\Core\AEXJobSystem.h"
+
+namespace AEX
+{
+	// Floating-point control word of the calling thread (rounding, denormals
+	// and, on x86, the x87 precision). Only those bits are read and written.
+	u32  GetFloatControl();
+	void SetFloatControl(u32 control);
+
+	// ----------------------------------------------------------------------------
+	// \class	WorkerPool
+	// \brief	Runs at most GetThreadCount() jobs of the JobSystem per
+	//			ParallelFor, the calling thread always takes part as worker 0,
+	//			so a pool of 1 thread runs everything inline. Worker indices
+	//			are stable in [0, GetThreadCount()) whatever JobSystem thread
+	//			runs them and can be used to index per-thread output buffers.
+	class WorkerPool
+	{
+	public:
+		// fn(worker, begin, end) processes the elements [begin, end)
+		typedef AEX::RangeFn RangeFn;
+
+		WorkerPool();
+		~WorkerPool();
+
+		// threadCount includes the calling thread. 0 means all the threads of
+		// the JobSystem (started now with hardware concurrency if it isn't).
+		void Initialize(u32 threadCount);
+		void Shutdown();
+		u32  GetThreadCount() const { return mThreadCount; }
+
+		// Splits [0, count) in chunks of at most grain elements and runs fn on
+		// them. Blocks until every chunk is done. The workers run the chunks 
+		// with the floating-point control word of the calling thread.
+		void ParallelFor(u32 count, u32 grain, const RangeFn & fn);
+
+	private:
+		u32		mThreadCount;
+	};
+}
+// ----------------------------------------------------------------------------
+#endif